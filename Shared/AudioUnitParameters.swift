@@ -21,6 +21,30 @@ import os
   case wetMix
   /// When true, the "odd" channels (R) have a LFO that is 90° advanced over the "even" channels (L).
   case odd90
+  /// When true, the LFO sweeps the all-pass filter frequency bands exponentially (equal musical intervals) instead of
+  /// linearly in Hz.
+  case logSweep
+  /// The number of phaser voices to run in parallel, each with its own LFO phase and rate and with slightly shifted
+  /// frequency bands (1-4).
+  case voices
+  /// When non-zero, the LFO is locked to the host tempo and beat position with a rate given as a note division instead
+  /// of Hz (see `AudioUnitParameters.syncDivisions`).
+  case sync
+  /// When true, the "odd" channels (R) use their own LFO and the `right*` settings below instead of sharing the
+  /// settings of the "even" channels (L).
+  case unlinked
+  /// The LFO rate of the "odd" channels in unlinked mode
+  case rightRate
+  /// The depth of the "odd" channels in unlinked mode
+  case rightDepth
+  /// The intensity of the "odd" channels in unlinked mode
+  case rightIntensity
+  /// The dry mix of the "odd" channels in unlinked mode
+  case rightDryMix
+  /// The wet mix of the "odd" channels in unlinked mode
+  case rightWetMix
+  /// When true, the output level is adjusted automatically to match the loudness of the input.
+  case autoGain
 }
 
 /**
@@ -43,16 +67,45 @@ public final class AudioUnitParameters: NSObject {
     AUParameterTree.createParameter(withIdentifier: "wet", name: "Wet", address: .wetMix,
                                     min: 0.0, max: 100.0, unit: .percent),
     AUParameterTree.createParameter(withIdentifier: "odd90", name: "Odd 90", address: .odd90, min: 0, max: 1,
+                                    unit: .boolean),
+    AUParameterTree.createParameter(withIdentifier: "logSweep", name: "Log Sweep", address: .logSweep, min: 0, max: 1,
+                                    unit: .boolean),
+    AUParameterTree.createParameter(withIdentifier: "voices", name: "Voices", address: .voices, min: 1, max: 4,
+                                    unit: .generic),
+    AUParameterTree.createParameter(withIdentifier: "sync", name: "Sync", address: .sync, min: 0,
+                                    max: AUValue(AudioUnitParameters.syncDivisions.count - 1), unit: .indexed,
+                                    valueStrings: AudioUnitParameters.syncDivisions),
+    AUParameterTree.createParameter(withIdentifier: "unlinked", name: "Unlinked", address: .unlinked, min: 0, max: 1,
+                                    unit: .boolean),
+    AUParameterTree.createParameter(withIdentifier: "rightRate", name: "Right Rate", address: .rightRate,
+                                    min: 0.02, max: 20.0, unit: .hertz),
+    AUParameterTree.createParameter(withIdentifier: "rightDepth", name: "Right Depth", address: .rightDepth,
+                                    min: 0.0, max: 100.0, unit: .percent),
+    AUParameterTree.createParameter(withIdentifier: "rightIntensity", name: "Right Intensity",
+                                    address: .rightIntensity, min: 0.0, max: 100.0, unit: .percent),
+    AUParameterTree.createParameter(withIdentifier: "rightDry", name: "Right Dry", address: .rightDryMix,
+                                    min: 0.0, max: 100.0, unit: .percent),
+    AUParameterTree.createParameter(withIdentifier: "rightWet", name: "Right Wet", address: .rightWetMix,
+                                    min: 0.0, max: 100.0, unit: .percent),
+    AUParameterTree.createParameter(withIdentifier: "autoGain", name: "Auto Gain", address: .autoGain, min: 0, max: 1,
                                     unit: .boolean)
   ]
   
+  /// Names of the tempo-synced LFO rates. These must match `MusicalContext::syncBeatsPerCycle` in the kernel.
+  public static let syncDivisions = ["Free", "4 Bars", "2 Bars", "1 Bar", "1/2", "1/4", "1/8", "1/16"]
+  
   /// Predefined presets for the effect
   public let factoryPresetValues:[(name: String, preset: FilterPreset)] = [
-    ("Gently Sweeps", FilterPreset(rate: 0.04, depth: 50,intensity: 75, dryMix: 50, wetMix: 50, odd90: 0)),
-    ("Slo-Jo", FilterPreset(rate: 0.10, depth: 100,intensity: 90, dryMix: 50, wetMix: 50, odd90: 1)),
-    ("Psycho Phase", FilterPreset(rate: 1.0, depth: 40, intensity: 90, dryMix: 0, wetMix: 100, odd90: 1)),
-    ("Phaser Blast", FilterPreset(rate: 1.0, depth: 100, intensity: 90, dryMix: 0, wetMix: 100, odd90: 0)),
-    ("Noxious", FilterPreset(rate: 20.0, depth: 30, intensity: 75, dryMix: 0, wetMix: 100, odd90: 1))
+    ("Gently Sweeps", FilterPreset(rate: 0.04, depth: 50,intensity: 75, dryMix: 50, wetMix: 50, odd90: 0, logSweep: 0,
+                                   voices: 1, sync: 0, unlinked: 0, autoGain: 0)),
+    ("Slo-Jo", FilterPreset(rate: 0.10, depth: 100,intensity: 90, dryMix: 50, wetMix: 50, odd90: 1, logSweep: 0,
+                            voices: 1, sync: 0, unlinked: 0, autoGain: 0)),
+    ("Psycho Phase", FilterPreset(rate: 1.0, depth: 40, intensity: 90, dryMix: 0, wetMix: 100, odd90: 1, logSweep: 0,
+                                  voices: 1, sync: 0, unlinked: 0, autoGain: 0)),
+    ("Phaser Blast", FilterPreset(rate: 1.0, depth: 100, intensity: 90, dryMix: 0, wetMix: 100, odd90: 0, logSweep: 0,
+                                  voices: 1, sync: 0, unlinked: 0, autoGain: 0)),
+    ("Noxious", FilterPreset(rate: 20.0, depth: 30, intensity: 75, dryMix: 0, wetMix: 100, odd90: 1, logSweep: 0,
+                             voices: 1, sync: 0, unlinked: 0, autoGain: 0))
   ]
   
   /// AUParameterTree created with the parameter definitions for the audio unit
@@ -70,6 +123,26 @@ public final class AudioUnitParameters: NSObject {
   public var wetMix: AUParameter { parameters[.wetMix] }
   /// Accessor for the odd90 parameter
   public var odd90: AUParameter { parameters[.odd90] }
+  /// Accessor for the logSweep parameter
+  public var logSweep: AUParameter { parameters[.logSweep] }
+  /// Accessor for the voices parameter
+  public var voices: AUParameter { parameters[.voices] }
+  /// Accessor for the sync parameter
+  public var sync: AUParameter { parameters[.sync] }
+  /// Accessor for the unlinked parameter
+  public var unlinked: AUParameter { parameters[.unlinked] }
+  /// Accessor for the rightRate parameter
+  public var rightRate: AUParameter { parameters[.rightRate] }
+  /// Accessor for the rightDepth parameter
+  public var rightDepth: AUParameter { parameters[.rightDepth] }
+  /// Accessor for the rightIntensity parameter
+  public var rightIntensity: AUParameter { parameters[.rightIntensity] }
+  /// Accessor for the rightDryMix parameter
+  public var rightDryMix: AUParameter { parameters[.rightDryMix] }
+  /// Accessor for the rightWetMix parameter
+  public var rightWetMix: AUParameter { parameters[.rightWetMix] }
+  /// Accessor for the autoGain parameter
+  public var autoGain: AUParameter { parameters[.autoGain] }
   
   /**
    Create a new AUParameterTree for the defined filter parameters.
@@ -116,7 +189,7 @@ extension AudioUnitParameters {
     let unitName = self[address].unitName ?? ""
     let separator: String = {
       switch address {
-      case .rate: return " "
+      case .rate, .rightRate: return " "
       default: return ""
       }
     }()
@@ -142,22 +215,19 @@ extension AudioUnitParameters {
    AudioUnit.
    */
   public func setValues(_ preset: FilterPreset) {
-    self.rate.value = preset.rate
-    self.depth.value = preset.depth
-    self.intensity.value = preset.intensity
-    self.dryMix.value = preset.dryMix
-    self.wetMix.value = preset.wetMix
-    self.odd90.value = preset.odd90
+    for (address, value) in preset.parameterValues {
+      self[address].value = value
+    }
   }
 }
 
 extension AudioUnitParameters {
   private func formatting(_ address: FilterParameterAddress) -> String {
     switch address {
-    case .rate: return "%.2f"
-    case .depth, .intensity: return "%.2f"
-    case .dryMix, .wetMix: return "%.0f"
-    case .odd90: return "%.0f"
+    case .rate, .rightRate: return "%.2f"
+    case .depth, .intensity, .rightDepth, .rightIntensity: return "%.2f"
+    case .dryMix, .wetMix, .rightDryMix, .rightWetMix: return "%.0f"
+    case .odd90, .logSweep, .voices, .sync, .unlinked, .autoGain: return "%.0f"
     default: return "?"
     }
   }
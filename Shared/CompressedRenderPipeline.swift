@@ -0,0 +1,338 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+import AVFoundation
+import os
+
+/**
+ Renders audio files through the phaser offline, reading and writing compressed formats such as FLAC and Opus with the
+ system codecs. Each file runs through a three-stage pipeline so that decoding and encoding overlap with the DSP:
+
+ - a decode thread reads fixed-size chunks ahead of the kernel into a small pool of buffers
+ - the kernel renders the chunks in order, followed by the tail of the effect
+ - an encode thread writes the rendered chunks to the output file
+
+ Files are processed in parallel, spread across all cores, each with its own kernel.
+
+ The output is byte-stable. Chunk boundaries depend only on `chunkFrames`. Each kernel renders its file serially from
+ a fresh state. Each output file is written by one encoder, in chunk order. The number of threads or files in flight
+ therefore has no effect on the bytes that are written.
+ */
+public final class CompressedRenderPipeline {
+  private static let log = Logging.logger("CompressedRenderPipeline")
+  private var log: OSLog { Self.log }
+
+  /// The encoding of an output file. The container comes from the extension of the output file name.
+  public enum Encoding {
+    /// Lossless FLAC (use a .flac file) holding samples of the given bit depth
+    case flac(bitDepth: Int)
+    /// Opus (use a .caf file) at the given bit rate. The sample rate must be one that Opus supports.
+    case opus(bitRate: Int)
+    /// The same format as the input file
+    case sameAsInput
+  }
+
+  /// A file to render.
+  public struct Job {
+    /// The location of the file to read
+    public let input: URL
+    /// The location of the file to write
+    public let output: URL
+    /// How to encode the output file
+    public let encoding: Encoding
+    /// The parameter settings to render with
+    public let preset: FilterPreset
+
+    public init(input: URL, output: URL, encoding: Encoding, preset: FilterPreset) {
+      self.input = input
+      self.output = output
+      self.encoding = encoding
+      self.preset = preset
+    }
+  }
+
+  /// Failure states of a job
+  public enum Failure: Swift.Error {
+    /// The output encoding does not support the sample rate of the input
+    case unsupportedSampleRate(Double)
+    /// Unable to allocate the sample buffers for the given format
+    case unableToAllocate(String)
+  }
+
+  /// Sample rates that Opus supports
+  public static let opusSampleRates: Set<Double> = [8000.0, 12000.0, 16000.0, 24000.0, 48000.0]
+
+  /// The output level below which the tail of a rendering ends
+  public let tailThreshold: AUValue
+  /// The max length of the tail of a rendering in seconds
+  public let maxTailDuration: Double
+  /// The number of frames in a chunk
+  public let chunkFrames: AVAudioFrameCount
+  /// The number of decoded chunks that can wait for the kernel, and of rendered chunks that can wait for the encoder
+  public let chunksAhead: Int
+
+  private let renderQueue: DispatchQueue
+
+  /**
+   Create a new pipeline.
+
+   - parameter chunkFrames: the number of frames in a chunk. Rounded up to a multiple of 512 so that rendering in chunks
+   gives the same result as rendering in one go.
+   - parameter chunksAhead: the number of chunks that each stage may work ahead of the next one
+   - parameter tailThreshold: the output level below which the tail of a rendering ends
+   - parameter maxTailDuration: the max length of the tail of a rendering in seconds
+   */
+  public init(chunkFrames: AVAudioFrameCount = 32768, chunksAhead: Int = 4, tailThreshold: AUValue = 1.0e-4,
+              maxTailDuration: Double = 10.0) {
+    self.chunkFrames = max(1, (chunkFrames + 511) / 512) * 512
+    self.chunksAhead = max(1, chunksAhead)
+    self.tailThreshold = tailThreshold
+    self.maxTailDuration = maxTailDuration
+    self.renderQueue = DispatchQueue(label: "CompressedRenderPipeline.render", qos: .utility)
+  }
+
+  /**
+   Render a collection of files. Rendering happens in the background.
+
+   - parameter jobs: the files to render
+   - parameter completion: closure called on the main queue with the result of each job, in the order of `jobs`. An
+   entry is nil if its job succeeded.
+   */
+  public func render(jobs: [Job], completion: @escaping ([Error?]) -> Void) {
+    renderQueue.async {
+      let results = UnsafeMutableBufferPointer<Error?>.allocate(capacity: jobs.count)
+      results.initialize(repeating: nil)
+      defer { results.deallocate() }
+
+      DispatchQueue.concurrentPerform(iterations: jobs.count) { index in
+        do {
+          try self.render(job: jobs[index])
+        } catch {
+          os_log(.error, log: self.log, "failed to render %{public}s - %{public}s", jobs[index].input.path,
+                 error.localizedDescription)
+          results[index] = error
+        }
+      }
+
+      let errors = Array(results)
+      DispatchQueue.main.async { completion(errors) }
+    }
+  }
+
+  /**
+   Render one file, blocking until it is done.
+
+   - parameter job: the file to render
+   */
+  public func render(job: Job) throws {
+    let inputFile = try AVAudioFile(forReading: job.input)
+    let format = inputFile.processingFormat
+    // Only the encode stage holds on to the output file, and it lets go when it is done so that the file is complete
+    // by the time this returns.
+    var outputFile: AVAudioFile? = try AVAudioFile(forWriting: job.output,
+                                                   settings: try settings(for: job.encoding, input: inputFile),
+                                                   commonFormat: format.commonFormat, interleaved: format.isInterleaved)
+
+    let kernel = SimplyPhaserKernelAdapter("CompressedRenderPipeline")
+    kernel.parameterLogging = false
+    kernel.startProcessing(format, maxFramesToRender: 512)
+    for (address, value) in job.preset.parameterValues {
+      kernel.setValue(value, forAddress: address.rawValue)
+    }
+    defer { kernel.stopProcessing() }
+
+    let decoded = ChunkQueue(capacity: chunksAhead)
+    let rendered = ChunkQueue(capacity: chunksAhead)
+    let decodePool = try BufferPool(format: format, frameCapacity: chunkFrames, count: chunksAhead + 1)
+    let encodePool = try BufferPool(format: format, frameCapacity: chunkFrames, count: chunksAhead + 1)
+
+    // Encode behind the kernel, in chunk order. After a failure, keep taking chunks so that the stages before this one
+    // never wait on it.
+    let encoder = Stage(name: "encode") { stage in
+      defer { outputFile = nil }
+      while let buffer = rendered.take() {
+        if !stage.hasFailed {
+          do {
+            try outputFile?.write(from: buffer)
+          } catch {
+            stage.fail(error)
+          }
+        }
+        encodePool.give(buffer)
+      }
+    }
+
+    // Decode ahead of the kernel until a read comes back empty. The length of a compressed file is only an estimate,
+    // so it is not used to find the end. The stream ends early if the encoder fails.
+    let decoder = Stage(name: "decode") { stage in
+      defer { decoded.put(nil) }
+      while !encoder.hasFailed {
+        let buffer = decodePool.take()
+        do {
+          try inputFile.read(into: buffer, frameCount: self.chunkFrames)
+        } catch {
+          decodePool.give(buffer)
+          stage.fail(error)
+          return
+        }
+        if buffer.frameLength == 0 {
+          decodePool.give(buffer)
+          return
+        }
+        decoded.put(buffer)
+      }
+    }
+
+    while let input = decoded.take() {
+      if !encoder.hasFailed {
+        let output = encodePool.take()
+        kernel.renderStream(input, output: output)
+        rendered.put(output)
+      }
+      decodePool.give(input)
+    }
+
+    var tailFrames = AVAudioFrameCount(maxTailDuration * format.sampleRate)
+    var tailDone = decoder.hasFailed
+    while tailFrames > 0 && !tailDone && !encoder.hasFailed {
+      let output = encodePool.take()
+      tailDone = kernel.renderTail(output, tailThreshold: tailThreshold)
+      output.frameLength = min(output.frameLength, tailFrames)
+      tailFrames -= output.frameLength
+      rendered.put(output)
+    }
+
+    rendered.put(nil)
+    try decoder.result()
+    try encoder.result()
+  }
+}
+
+private extension CompressedRenderPipeline {
+
+  func settings(for encoding: Encoding, input: AVAudioFile) throws -> [String: Any] {
+    let format = input.processingFormat
+    switch encoding {
+    case .flac(let bitDepth):
+      return [AVFormatIDKey: kAudioFormatFLAC, AVSampleRateKey: format.sampleRate,
+              AVNumberOfChannelsKey: format.channelCount, AVEncoderBitDepthHintKey: bitDepth]
+    case .opus(let bitRate):
+      guard Self.opusSampleRates.contains(format.sampleRate) else {
+        throw Failure.unsupportedSampleRate(format.sampleRate)
+      }
+      return [AVFormatIDKey: kAudioFormatOpus, AVSampleRateKey: format.sampleRate,
+              AVNumberOfChannelsKey: format.channelCount, AVEncoderBitRateKey: bitRate]
+    case .sameAsInput:
+      return input.fileFormat.settings
+    }
+  }
+}
+
+/// A fixed set of sample buffers that are handed out and given back, so that no allocations happen per chunk.
+private final class BufferPool {
+  private var buffers: [AVAudioPCMBuffer]
+  private let available: DispatchSemaphore
+  private let lock = NSLock()
+
+  init(format: AVAudioFormat, frameCapacity: AVAudioFrameCount, count: Int) throws {
+    buffers = try (0..<count).map { _ in
+      guard let buffer = AVAudioPCMBuffer(pcmFormat: format, frameCapacity: frameCapacity) else {
+        throw CompressedRenderPipeline.Failure.unableToAllocate(format.description)
+      }
+      return buffer
+    }
+    available = DispatchSemaphore(value: count)
+  }
+
+  /// Obtain a buffer, waiting for one to be given back if necessary.
+  func take() -> AVAudioPCMBuffer {
+    available.wait()
+    lock.lock()
+    defer { lock.unlock() }
+    return buffers.removeLast()
+  }
+
+  /// Return a buffer to the pool.
+  func give(_ buffer: AVAudioPCMBuffer) {
+    lock.lock()
+    buffers.append(buffer)
+    lock.unlock()
+    available.signal()
+  }
+}
+
+/// A bounded first-in first-out queue of chunks between two pipeline stages. A nil chunk marks the end of the stream.
+private final class ChunkQueue {
+  private var chunks = [AVAudioPCMBuffer?]()
+  private let condition = NSCondition()
+  private let capacity: Int
+
+  init(capacity: Int) { self.capacity = capacity }
+
+  /**
+   Add a chunk, waiting for room if the queue is full.
+
+   - parameter chunk: the chunk to add, or nil to end the stream
+   */
+  func put(_ chunk: AVAudioPCMBuffer?) {
+    condition.lock()
+    defer { condition.unlock() }
+    while chunks.count >= capacity { condition.wait() }
+    chunks.append(chunk)
+    condition.broadcast()
+  }
+
+  /**
+   Remove the oldest chunk, waiting for one if the queue is empty.
+
+   - returns: the chunk, or nil at the end of the stream
+   */
+  func take() -> AVAudioPCMBuffer? {
+    condition.lock()
+    defer { condition.unlock() }
+    while chunks.isEmpty { condition.wait() }
+    let chunk = chunks.removeFirst()
+    condition.broadcast()
+    return chunk
+  }
+}
+
+/// A pipeline stage that runs on its own thread. The threads are kept out of the Dispatch pool, since the stages block
+/// on each other and would otherwise tie up its worker threads.
+private final class Stage {
+  private let done = DispatchSemaphore(value: 0)
+  private let lock = NSLock()
+  private var error: Error?
+
+  init(name: String, body: @escaping (Stage) -> Void) {
+    let thread = Thread { [self] in
+      body(self)
+      done.signal()
+    }
+    thread.name = "CompressedRenderPipeline.\(name)"
+    thread.qualityOfService = .utility
+    thread.start()
+  }
+
+  /// True if the stage has failed
+  var hasFailed: Bool {
+    lock.lock()
+    defer { lock.unlock() }
+    return error != nil
+  }
+
+  /// Record the failure of the stage. Only the first error is kept.
+  func fail(_ error: Error) {
+    lock.lock()
+    if self.error == nil { self.error = error }
+    lock.unlock()
+  }
+
+  /// Wait for the stage to finish and throw the error it failed with, if any.
+  func result() throws {
+    done.wait()
+    done.signal()
+    lock.lock()
+    defer { lock.unlock() }
+    if let error = error { throw error }
+  }
+}
@@ -136,6 +136,12 @@ public final class FilterAudioUnit: AUAudioUnit {
   
   private lazy var factoryPresetValues = parameterDefinitions.factoryPresetValues
   
+  /// Location of the engine settings tuned for this machine
+  private static var wisdomLocation: URL? {
+    FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first?
+      .appendingPathComponent("SimplyPhaser.wisdom")
+  }
+  
   private var _currentPreset: AUAudioUnitPreset? {
     didSet { os_log(.debug, log: log, "* _currentPreset name: %{public}s", _currentPreset.descriptionOrNil) }
   }
@@ -169,6 +175,30 @@ public final class FilterAudioUnit: AUAudioUnit {
     }
   }
   
+  /**
+   Benchmark the engine settings on this machine in the background and save the best ones for audio units created
+   later on. Audio units that already exist keep the settings they have. Tuning keeps a core busy for a while, so it
+   never starts by itself: it would compete with rendering and skew its own timings. The host app runs it on request.
+   The settings are kept in the caches directory of the calling process, so they apply to audio units loaded by that
+   process.
+   
+   - parameter sampleRates: the sample rates to tune for
+   - parameter completion: closure called on the main queue with true if the settings were saved
+   */
+  public class func tuneEngine(sampleRates: [Double] = [44100.0, 48000.0, 88200.0, 96000.0],
+                               completion: @escaping (Bool) -> Void = { _ in }) {
+    guard let wisdom = wisdomLocation else {
+      completion(false)
+      return
+    }
+    DispatchQueue.global(qos: .utility).async {
+      let saved = SimplyPhaserKernelAdapter.tuneWisdom(wisdom.path,
+                                                       sampleRates: sampleRates.map { NSNumber(value: $0) })
+      os_log(.info, log: Self.log, "tuned engine settings - saved: %d", saved)
+      DispatchQueue.main.async { completion(saved) }
+    }
+  }
+  
   /**
    Construct new instance, throwing exception if there is an error doing so.
    
@@ -204,6 +234,11 @@ public final class FilterAudioUnit: AUAudioUnit {
     maximumFramesToRender = maxFramesToRender
     currentPreset = factoryPresets.first
     
+    // Use engine settings tuned for this machine if there are any. Otherwise the kernel keeps its defaults.
+    if let wisdom = Self.wisdomLocation, !kernel.loadWisdom(wisdom.path) {
+      os_log(.info, log: log, "no engine wisdom - using default settings")
+    }
+    
     // This really should be postponed until allocateRenderResources is called. However, for some weird reason
     // internalRenderBlock is fetched before allocateRenderResources() gets called, so we need to preflight here.
     kernel.startProcessing(format, maxFramesToRender: maxFramesToRender)
@@ -227,9 +262,20 @@ public final class FilterAudioUnit: AUAudioUnit {
       //
       throw NSError(domain: NSOSStatusErrorDomain, code: Int(kAudioUnitErr_FailedInitialization), userInfo: nil)
     }
-    
+
+    // The kernel renders float32 or float64 samples as-is, but both busses must use the same one.
+    let commonFormat = inputBus.format.commonFormat
+    if outputBus.format.commonFormat != commonFormat ||
+        (commonFormat != .pcmFormatFloat32 && commonFormat != .pcmFormatFloat64) {
+      os_log(.error, log: log, "unsupported sample format")
+      setRenderResourcesAllocated(false)
+      throw NSError(domain: NSOSStatusErrorDomain, code: Int(kAudioUnitErr_FormatNotSupported), userInfo: nil)
+    }
+
     // Communicate to the kernel the new formats being used
     kernel.startProcessing(inputBus.format, maxFramesToRender: maximumFramesToRender)
+    kernel.musicalContextBlock = musicalContextBlock
+    kernel.transportStateBlock = transportStateBlock
     
     try super.allocateRenderResources()
   }
@@ -240,6 +286,8 @@ public final class FilterAudioUnit: AUAudioUnit {
   override public func deallocateRenderResources() {
     os_log(.debug, log: log, "before super.deallocateRenderResources")
     kernel.stopProcessing()
+    kernel.musicalContextBlock = nil
+    kernel.transportStateBlock = nil
     super.deallocateRenderResources()
     os_log(.debug, log: log, "after super.deallocateRenderResources")
   }
@@ -11,4 +11,35 @@ public struct FilterPreset {
   let dryMix: AUValue
   let wetMix: AUValue
   let odd90: AUValue
+  let logSweep: AUValue
+  let voices: AUValue
+  let sync: AUValue
+  let unlinked: AUValue
+  let autoGain: AUValue
+}
+
+extension FilterPreset {
+
+  /// The parameter values of the preset by address. Presets hold one set of values, so the settings of the "odd"
+  /// channels are the same as those of the "even" channels.
+  public var parameterValues: [(address: FilterParameterAddress, value: AUValue)] {
+    [
+      (.rate, rate),
+      (.depth, depth),
+      (.intensity, intensity),
+      (.dryMix, dryMix),
+      (.wetMix, wetMix),
+      (.odd90, odd90),
+      (.logSweep, logSweep),
+      (.voices, voices),
+      (.sync, sync),
+      (.unlinked, unlinked),
+      (.rightRate, rate),
+      (.rightDepth, depth),
+      (.rightIntensity, intensity),
+      (.rightDryMix, dryMix),
+      (.rightWetMix, wetMix),
+      (.autoGain, autoGain)
+    ]
+  }
 }
@@ -0,0 +1,112 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+/**
+ Output level compensation that keeps the processed signal about as loud as the input. The mean-square power of the
+ input and of the output is measured once per render block and smoothed over `timeConstant` seconds. The gain that
+ would make the two match is then smoothed the same way. The gain only changes between blocks, so the kernel can fold
+ it into the dry and wet mix factors it already applies to every sample.
+
+ The output power is measured after the current gain is applied, so the gain is divided back out before it is compared
+ with the input power. When either signal is close to silent the gain holds its value, so that it does not rise
+ during pauses. Blocks whose power is NaN or Inf are ignored, since one of them would stick in the smoothed values for
+ good.
+ */
+template <typename T>
+class AutoGain {
+public:
+
+  /// Largest gain that will be applied (+12 dB)
+  static constexpr T maxGain = 4.0;
+  /// Smallest gain that will be applied (-12 dB)
+  static constexpr T minGain = 0.25;
+  /// Mean-square power below which a signal counts as silent (-80 dBFS)
+  static constexpr T silence = 1.0e-8;
+
+  /**
+   Construct new instance.
+
+   @param timeConstant the time in seconds for the smoothed powers and gain to move most of the way to a new level
+   */
+  explicit AutoGain(T timeConstant = 0.3) : timeConstant_{timeConstant} {}
+
+  /**
+   Set the sample rate to use for the smoothing. Also resets the gain to unity.
+
+   @param sampleRate the sample rate in use
+   */
+  void initialize(T sampleRate) {
+    sampleRate_ = sampleRate;
+    reset();
+  }
+
+  /**
+   Forget the measured powers and return to unity gain.
+   */
+  void reset() {
+    inputPower_ = 0.0;
+    outputPower_ = 0.0;
+    gain_ = 1.0;
+  }
+
+  /// @returns the gain to apply to the output of the next block
+  T gain() const { return gain_; }
+
+  /**
+   Take in the power measurements of a block and update the gain for the next one.
+
+   @param inputPower the mean-square power of the input samples of the block
+   @param outputPower the mean-square power of the output samples of the block (with the current gain applied)
+   @param frameCount the number of frames in the block
+   */
+  void update(T inputPower, T outputPower, size_t frameCount) {
+    if (frameCount == 0 || sampleRate_ <= 0.0 || !std::isfinite(inputPower) || !std::isfinite(outputPower)) return;
+    T smoothing = T(1.0) - std::exp(-T(frameCount) / (timeConstant_ * sampleRate_));
+    inputPower_ += (inputPower - inputPower_) * smoothing;
+    outputPower_ += (outputPower / (gain_ * gain_) - outputPower_) * smoothing;
+    if (inputPower_ < silence || outputPower_ < silence) return;
+    T target = std::clamp<T>(std::sqrt(inputPower_ / outputPower_), minGain, maxGain);
+    gain_ += (target - gain_) * smoothing;
+  }
+
+  /**
+   Obtain the mean-square power of a collection of sample buffers. The sum is kept in several independent parts so that
+   the additions do not all depend on each other and can run in parallel.
+
+   @param buffers the buffers to measure (one per channel)
+   @param frameCount the number of samples in each buffer
+   @returns the mean of the squared samples over all buffers
+   */
+  template <typename Buffers>
+  static T meanSquare(const Buffers& buffers, size_t frameCount) {
+    if (buffers.empty() || frameCount == 0) return 0.0;
+    constexpr size_t partCount = 4;
+    std::array<T, partCount> parts{};
+    for (auto buffer : buffers) {
+      size_t frame = 0;
+      for (; frame + partCount <= frameCount; frame += partCount) {
+        for (size_t part = 0; part < partCount; ++part) {
+          T sample = buffer[frame + part];
+          parts[part] += sample * sample;
+        }
+      }
+      for (; frame < frameCount; ++frame) {
+        T sample = buffer[frame];
+        parts[0] += sample * sample;
+      }
+    }
+    return (parts[0] + parts[1] + parts[2] + parts[3]) / T(buffers.size() * frameCount);
+  }
+
+private:
+  T timeConstant_;
+  T sampleRate_{0.0};
+  T inputPower_{0.0};
+  T outputPower_{0.0};
+  T gain_{1.0};
+};
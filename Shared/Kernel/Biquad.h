@@ -2,10 +2,13 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
 #include <os/log.h>
 
+#include "TrigRecurrence.h"
+
 namespace Biquad {
 
 /**
@@ -137,7 +140,16 @@ struct Coefficients {
    @returns Coefficients collection
    */
   static Coefficients<T> APF1(T sampleRate, T frequency) {
-    double tangent = std::tan(M_PI * frequency / sampleRate);
+    return APF1FromTangent(std::tan(M_PI * frequency / sampleRate));
+  }
+  
+  /**
+   A 1-pole all-pass filter coefficients generator that works from a precalculated tangent value.
+   
+   @param tangent the value of tan(pi * frequency / sampleRate)
+   @returns Coefficients collection
+   */
+  static Coefficients<T> APF1FromTangent(double tangent) {
     double alpha = (tangent - 1.0) / (tangent + 1.0);
     return Coefficients(alpha, 1.0, 0.0, alpha, 0.0);
   }
@@ -154,9 +166,19 @@ struct Coefficients {
     double bandwidth = frequency / resonance;
     double argTan = M_PI * bandwidth / sampleRate;
     if (argTan >= 0.95 * M_PI / 2.0) argTan = 0.95 * M_PI / 2.0;
-    double tangent = std::tan(argTan);
+    return APF2FromTrig(std::tan(argTan), std::cos(2.0 * M_PI * frequency / sampleRate));
+  }
+  
+  /**
+   A 2-pole all-pass filter coefficients generator that works from precalculated trigonometric values.
+   
+   @param tangent the value of tan(pi * bandwidth / sampleRate) where bandwidth is frequency / resonance
+   @param cosine the value of cos(2 * pi * frequency / sampleRate)
+   @returns Coefficients collection
+   */
+  static Coefficients<T> APF2FromTrig(double tangent, double cosine) {
     double alpha = (tangent - 1.0) / (tangent + 1.0);
-    double beta = -std::cos(2.0 * M_PI * frequency / sampleRate);
+    double beta = -cosine;
     return Coefficients(-alpha, beta * (1.0 - alpha), 1.0, beta * (1.0 - alpha), -alpha);
   }
   
@@ -169,6 +191,98 @@ struct Coefficients {
   inline static os_log_t log_{os_log_create("DSP.Biquad", "Coefficients")};
 };
 
+/**
+ Generates 1-pole all-pass filter coefficients for a frequency that moves in small steps, such as one swept by an LFO.
+ The tangent is advanced from the previous frequency with `DSP::TangentRecurrence`, so an update costs a few
+ multiply-adds and a division instead of a call to `std::tan`.
+ */
+template <typename T>
+class APF1Updater {
+public:
+  
+  /**
+   Construct new instance.
+   
+   @param sampleRate the sample rate being used
+   @param stepsPerAnchor number of incremental updates before the tangent is recalculated exactly
+   */
+  explicit APF1Updater(T sampleRate, int stepsPerAnchor = 64)
+  : angleScale_{M_PI / sampleRate}, tangent_{stepsPerAnchor} {}
+  
+  /**
+   Obtain the coefficients for a new frequency.
+   
+   @param frequency the cutoff frequency of the filter
+   @returns Coefficients collection
+   */
+  Coefficients<T> operator()(T frequency) {
+    return Coefficients<T>::APF1FromTangent(tangent_(angleScale_ * frequency));
+  }
+
+  /**
+   Forget the previous frequency, so that the coefficients that follow are the same as those of a new instance.
+   */
+  void reset() { tangent_.reset(); }
+
+  /**
+   Determine if another instance is in the same state, so that both return the same coefficients from here on.
+
+   @param other the instance to compare with
+   @returns true if the states are identical
+   */
+  bool operator==(const APF1Updater<T>& other) const {
+    return angleScale_ == other.angleScale_ && tangent_ == other.tangent_;
+  }
+  
+private:
+  T angleScale_;
+  DSP::TangentRecurrence<T> tangent_;
+};
+
+/**
+ Generates 2-pole all-pass filter coefficients for a frequency that moves in small steps. The bandwidth tangent is
+ advanced with `DSP::TangentRecurrence` and the cosine of the center frequency with `DSP::SineCosineRecurrence`.
+ */
+template <typename T>
+class APF2Updater {
+public:
+  
+  /**
+   Construct new instance.
+   
+   @param sampleRate the sample rate being used
+   @param stepsPerAnchor number of incremental updates before the values are recalculated exactly
+   */
+  explicit APF2Updater(T sampleRate, int stepsPerAnchor = 64)
+  : angleScale_{M_PI / sampleRate}, tangent_{stepsPerAnchor}, rotation_{stepsPerAnchor} {}
+  
+  /**
+   Obtain the coefficients for a new frequency.
+   
+   @param frequency the cutoff frequency of the filter
+   @param resonance the filter resonance parameter (Q)
+   @returns Coefficients collection
+   */
+  Coefficients<T> operator()(T frequency, T resonance) {
+    T argTan = std::min<T>(angleScale_ * frequency / resonance, 0.95 * M_PI / 2.0);
+    rotation_(2.0 * angleScale_ * frequency);
+    return Coefficients<T>::APF2FromTrig(tangent_(argTan), rotation_.cosine());
+  }
+
+  /**
+   Forget the previous frequency, so that the coefficients that follow are the same as those of a new instance.
+   */
+  void reset() {
+    tangent_.reset();
+    rotation_.reset();
+  }
+  
+private:
+  T angleScale_;
+  DSP::TangentRecurrence<T> tangent_;
+  DSP::SineCosineRecurrence<T> rotation_;
+};
+
 /**
  Mutable filter state.
  */
@@ -315,8 +429,9 @@ struct CanonicalTranspose : Base<T> {
    */
   static T transform(T input, State<T>& state, const Coefficients<T>& coefficients) {
     T output = Base<T>::forceMinToZero(coefficients.a0 * input + state.x_z1);
-    state.x_z1 = coefficients.a1 * input - coefficients.b1 * output + state.x_z2;
-    state.x_z2 = coefficients.a2 * input - coefficients.b2 * output;
+    // The state feeds back into itself, so it must be flushed as well or it decays into subnormal values in silence.
+    state.x_z1 = Base<T>::forceMinToZero(coefficients.a1 * input - coefficients.b1 * output + state.x_z2);
+    state.x_z2 = Base<T>::forceMinToZero(coefficients.a2 * input - coefficients.b2 * output);
     return output;
   }
   
@@ -380,7 +495,6 @@ public:
 private:
   Coefficients<T> coefficients_;
   State<T> state_;
-  os_log_t log_{os_log_create("DSP.Biquad", "Filter")};
 };
 
 template <typename T>
@@ -0,0 +1,132 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "Biquad.h"
+
+namespace Biquad {
+
+/**
+ A serial chain of biquad filters in the transposed canonical form (see `Transform::CanonicalTranspose`), where the
+ output of one stage is the input of the next and nothing is fed back from a later stage to an earlier one.
+
+ Run one sample at a time, such a chain is strictly sequential since each stage waits on the one before it. Here the
+ stages are run as a wavefront instead: in one step stage `k` works on sample `n - k` while stage `k + 1` works on
+ sample `n - k - 1`. All stages in a step are then independent of each other, and since the coefficients and states
+ are kept as one array per value, the compiler can put the stages into SIMD lanes. The wavefront fills at the start of
+ a block and drains at its end, so the output of `process` is the same as running the stages one after the other and
+ there is no added latency.
+
+ Stage coefficients can change between calls to `process`. Cascades that have feedback around the whole chain, such
+ as the PhaseShifter, do not fit this scheme.
+ */
+template <typename T, size_t Stages>
+class WavefrontCascade {
+public:
+  static_assert(Stages > 0, "cascade must have at least one stage");
+
+  /**
+   Construct new cascade with all stages using the given coefficients.
+
+   @param coefficients the coefficients to use for all stages
+   */
+  explicit WavefrontCascade(const Coefficients<T>& coefficients = Coefficients<T>()) {
+    for (size_t stage = 0; stage < Stages; ++stage) setCoefficients(stage, coefficients);
+    reset();
+  }
+
+  /**
+   Use a new set of biquad coefficients for one stage.
+
+   @param stage the index of the stage to change
+   @param coefficients the new coefficients
+   */
+  void setCoefficients(size_t stage, const Coefficients<T>& coefficients) {
+    assert(stage < Stages);
+    a0_[stage] = coefficients.a0;
+    a1_[stage] = coefficients.a1;
+    a2_[stage] = coefficients.a2;
+    b1_[stage] = coefficients.b1;
+    b2_[stage] = coefficients.b2;
+  }
+
+  /**
+   Reset the internal state of all stages.
+   */
+  void reset() {
+    z1_.fill(0.0);
+    z2_.fill(0.0);
+  }
+
+  /**
+   Filter a block of samples through all of the stages. The input and output may be the same buffer.
+
+   @param input the samples to filter
+   @param output the buffer to hold the filtered samples
+   @param frameCount the number of samples to filter
+   */
+  void process(T const* input, T* output, size_t frameCount) {
+    std::array<T, Stages> lanes{};
+    std::array<T, Stages> outputs{};
+    auto stepCount = frameCount + Stages - 1;
+    for (size_t step = 0; step < stepCount; ++step) {
+      lanes[0] = step < frameCount ? input[step] : 0.0;
+
+      // Stage `k` holds sample `step - k`, so only some of the stages hold a valid sample while the wavefront fills
+      // and drains.
+      auto first = step < frameCount ? 0 : step - frameCount + 1;
+      auto last = std::min(step, Stages - 1);
+      if (first == 0 && last == Stages - 1) {
+        transform(lanes, outputs);
+      }
+      else {
+        transform(lanes, outputs, first, last);
+      }
+
+      if (step >= Stages - 1) output[step - (Stages - 1)] = outputs[Stages - 1];
+      std::copy(outputs.begin(), outputs.end() - 1, lanes.begin() + 1);
+    }
+  }
+
+private:
+
+  static T forceMinToZero(T value) { return std::abs(value) < std::numeric_limits<float>::min() ? 0.0 : value; }
+
+  /// Run one wavefront step over all of the stages. This loop has no dependencies between iterations.
+  void transform(const std::array<T, Stages>& inputs, std::array<T, Stages>& outputs) {
+    for (size_t stage = 0; stage < Stages; ++stage) {
+      auto input = inputs[stage];
+      auto output = forceMinToZero(a0_[stage] * input + z1_[stage]);
+      z1_[stage] = forceMinToZero(a1_[stage] * input - b1_[stage] * output + z2_[stage]);
+      z2_[stage] = forceMinToZero(a2_[stage] * input - b2_[stage] * output);
+      outputs[stage] = output;
+    }
+  }
+
+  /// Run one wavefront step over the stages `first` through `last` (inclusive) while filling or draining.
+  void transform(const std::array<T, Stages>& inputs, std::array<T, Stages>& outputs, size_t first, size_t last) {
+    for (size_t stage = first; stage <= last; ++stage) {
+      auto input = inputs[stage];
+      auto output = forceMinToZero(a0_[stage] * input + z1_[stage]);
+      z1_[stage] = forceMinToZero(a1_[stage] * input - b1_[stage] * output + z2_[stage]);
+      z2_[stage] = forceMinToZero(a2_[stage] * input - b2_[stage] * output);
+      outputs[stage] = output;
+    }
+  }
+
+  std::array<T, Stages> a0_;
+  std::array<T, Stages> a1_;
+  std::array<T, Stages> a2_;
+  std::array<T, Stages> b1_;
+  std::array<T, Stages> b2_;
+  std::array<T, Stages> z1_;
+  std::array<T, Stages> z2_;
+};
+
+} // namespace Biquad
@@ -0,0 +1,88 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#pragma once
+
+#import <atomic>
+#import <memory>
+#import <string>
+#import <thread>
+#import <vector>
+#import <AVFoundation/AVFoundation.h>
+#include <dispatch/dispatch.h>
+
+#import "SimplyPhaserKernel.h"
+
+/**
+ Offline renderer for large batches of short clips. Holds one warm SimplyPhaserKernel per worker thread so that the
+ per-clip cost is only a state reset, and spreads the clips across all cores. Each clip is rendered from a reset
+ kernel and is followed by a tail that ends once the output decays below a threshold (see
+ `SimplyPhaserKernel::renderClip`). All parameters should be set via `setParameterValue` before rendering.
+ */
+class ClipBatchRenderer {
+public:
+
+  /// A clip to render along with the place to hold its output.
+  struct Clip {
+    /// The input samples of the clip, one buffer per channel
+    std::vector<AUValue const*> ins;
+    /// The output buffers for the clip, one per channel. Each must hold `frameCount + maxTailFrames` samples.
+    std::vector<AUValue*> outs;
+    /// The number of frames in the clip
+    size_t frameCount;
+    /// The number of frames written to `outs`, set after rendering
+    size_t renderedFrameCount = 0;
+  };
+
+  /**
+   Construct new renderer.
+
+   @param name the logging subsystem to use when emitting log statements
+   @param format the format of the clips to render
+   @param workerCount the number of clips to render at the same time (0 for one per core)
+   */
+  ClipBatchRenderer(const std::string& name, AVAudioFormat* format, size_t workerCount = 0) {
+    if (workerCount == 0) workerCount = std::max(1u, std::thread::hardware_concurrency());
+    kernels_.reserve(workerCount);
+    for (size_t index = 0; index < workerCount; ++index) {
+      kernels_.emplace_back(std::make_unique<SimplyPhaserKernel>(name));
+      kernels_.back()->setParameterLogging(false);
+      kernels_.back()->startProcessing(format, 512);
+    }
+  }
+
+  /**
+   Change a runtime parameter value in all of the kernels.
+
+   @param address the unique address of the parameter to change
+   @param value the new value to assign to the parameter
+   */
+  void setParameterValue(AUParameterAddress address, AUValue value) {
+    for (auto& kernel : kernels_) {
+      kernel->setParameterValue(address, value);
+    }
+  }
+
+  /**
+   Render a batch of clips in parallel. Returns when all clips have been rendered.
+
+   @param clips the clips to render
+   @param maxTailFrames the maximum number of tail frames to render after each clip
+   @param tailThreshold the output level below which a tail is considered done
+   */
+  void render(std::vector<Clip>& clips, size_t maxTailFrames, AUValue tailThreshold) {
+    std::atomic<size_t> next{0};
+    auto clipsPtr = &clips;
+    auto nextPtr = &next;
+    dispatch_apply(kernels_.size(), dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^(size_t worker) {
+      auto& kernel = *kernels_[worker];
+      for (auto index = nextPtr->fetch_add(1); index < clipsPtr->size(); index = nextPtr->fetch_add(1)) {
+        auto& clip = (*clipsPtr)[index];
+        clip.renderedFrameCount = kernel.renderClip(clip.ins, clip.outs, clip.frameCount, maxTailFrames,
+                                                    tailThreshold);
+      }
+    });
+  }
+
+private:
+  std::vector<std::unique_ptr<SimplyPhaserKernel>> kernels_;
+};
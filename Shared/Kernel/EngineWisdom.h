@@ -0,0 +1,316 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#pragma once
+
+#import <algorithm>
+#import <chrono>
+#import <cmath>
+#import <cstdio>
+#import <cstring>
+#import <fstream>
+#import <limits>
+#import <map>
+#import <sstream>
+#import <string>
+#import <vector>
+
+#import <sys/sysctl.h>
+
+#import "PhaseShifter.h"
+#import "SpectralLoss.h"
+
+/**
+ Engine settings tuned for the machine that runs the kernel, in the spirit of FFTW "wisdom". The best number of
+ samples between filter updates and the best number of incremental coefficient updates between exact ones depend on
+ the CPU, so instead of one hand-picked pair of values for all machines, `tune` benchmarks a grid of candidates and
+ picks the fastest one whose output stays within an accuracy budget. The results are kept per sample rate and can be
+ saved to a small text file that kernels load at startup. Tuning is never started automatically; the host app creates
+ the file on request (see `FilterAudioUnit.tuneEngine`).
+
+ A wisdom file is only accepted if it was written by the same file version on a machine with the same CPU. When there
+ is no file, or it is not accepted, or it has no entry for the sample rate in use, the kernel uses `defaults`.
+ */
+class EngineWisdom {
+public:
+
+  /// The engine settings that are tuned.
+  struct Settings {
+    /// Number of samples to render before updating the all-pass filter coefficients
+    int samplesPerFilterUpdate;
+    /// Number of incremental coefficient updates before the coefficients are recalculated exactly
+    int stepsPerAnchor;
+
+    bool operator ==(const Settings& other) const {
+      return samplesPerFilterUpdate == other.samplesPerFilterUpdate && stepsPerAnchor == other.stepsPerAnchor;
+    }
+  };
+
+  /// The settings to use when there is no wisdom. These are the values the kernel always used before tuning existed.
+  static constexpr Settings defaults{20, 64};
+
+  /// The settings of the reference rendering, which updates the filters on every sample with exact coefficients
+  static constexpr Settings reference{1, 1};
+
+  /// The largest loss above that of the reference rendering that `tune` accepts (see `Benchmark::loss`). The loss
+  /// grows with the time between filter updates, so the same budget allows more samples between updates at higher
+  /// sample rates. The defaults are just within it at 44.1 kHz.
+  static constexpr double accuracyTolerance = 0.2;
+
+  /// Version of the file layout written by `save`
+  static constexpr int fileVersion = 1;
+
+  /// Candidate values for `Settings::samplesPerFilterUpdate`
+  inline static const std::vector<int> samplesPerFilterUpdateCandidates{1, 2, 4, 8, 12, 16, 20, 24, 32, 48, 64};
+
+  /// Candidate values for `Settings::stepsPerAnchor`
+  inline static const std::vector<int> stepsPerAnchorCandidates{16, 32, 64, 128, 256};
+
+  /**
+   Renders a test signal with different settings, and measures how long that takes and how far the output is from a
+   reference rendering. The test uses the fastest and deepest LFO sweep the kernel supports, which is where stale
+   filter coefficients hurt the most. The reference updates the filters on every sample with exact coefficients.
+   */
+  class Benchmark {
+  public:
+
+    /// LFO rate of the test sweep (the max of the rate parameter)
+    static constexpr double sweepRate = 20.0;
+    /// Intensity of the test rendering
+    static constexpr double intensity = 0.9;
+
+    /**
+     Construct new benchmark.
+
+     @param sampleRate the sample rate to render at
+     @param duration the length in seconds of the test signal
+     */
+    Benchmark(double sampleRate, double duration = 0.5)
+    : sampleRate_{sampleRate}, input_(noise(size_t(sampleRate * duration))), output_(input_.size()),
+    loss_{renderReference(), output_.size()}
+    {}
+
+    /**
+     Obtain how different the output with the given settings sounds from the reference output (see `SpectralLoss`).
+
+     @param settings the settings to render with
+     @returns the loss (0.0 for identical output)
+     */
+    double loss(Settings settings) {
+      render(settings);
+      return loss_(output_.data());
+    }
+
+    /**
+     Obtain the time it takes to render the test signal with the given settings. The shortest time of several runs is
+     used, since it is the one least disturbed by other activity on the machine.
+
+     @param settings the settings to render with
+     @param repetitions the number of times to render
+     @returns the shortest render time in seconds
+     */
+    double seconds(Settings settings, int repetitions = 5) {
+      double best = std::numeric_limits<double>::max();
+      for (int run = 0; run < repetitions; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        render(settings);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+      }
+      return best;
+    }
+
+  private:
+
+    /// White noise from a fixed seed, so that every run of the benchmark sees the same input.
+    static std::vector<double> noise(size_t frameCount) {
+      std::vector<double> samples(frameCount);
+      uint32_t state = 1;
+      for (auto& sample : samples) {
+        state = state * 1664525u + 1013904223u;
+        sample = (state >> 8) / double(1 << 23) - 1.0;
+      }
+      return samples;
+    }
+
+    double const* renderReference() {
+      render(reference);
+      return output_.data();
+    }
+
+    void render(Settings settings) {
+      PhaseShifter<double> shifter(PhaseShifter<double>::ideal, sampleRate_, intensity, settings.samplesPerFilterUpdate,
+                                   settings.stepsPerAnchor);
+      double phaseIncrement = 2.0 * M_PI * sweepRate / sampleRate_;
+      for (size_t frame = 0; frame < input_.size(); ++frame) {
+        output_[frame] = shifter.process(std::sin(phaseIncrement * frame), input_[frame]);
+      }
+    }
+
+    double sampleRate_;
+    std::vector<double> input_;
+    std::vector<double> output_;
+    SpectralLoss<double> loss_;
+  };
+
+  /**
+   Find the fastest settings whose output is within `accuracyTolerance` of the reference rendering.
+
+   @param sampleRate the sample rate to tune for
+   @param duration the length in seconds of the test signal
+   @returns the best settings, or `defaults` if no candidate is within the budget
+   */
+  static Settings tune(double sampleRate, double duration = 0.5) {
+    Benchmark benchmark(sampleRate, duration);
+    return tune(benchmark, benchmark.loss(reference) + accuracyTolerance);
+  }
+
+  /**
+   Find the fastest settings whose output is within an accuracy budget.
+
+   @param sampleRate the sample rate to tune for
+   @param accuracyBudget the largest acceptable loss (see `Benchmark::loss`)
+   @param duration the length in seconds of the test signal
+   @returns the best settings, or `defaults` if no candidate is within the budget
+   */
+  static Settings tune(double sampleRate, double accuracyBudget, double duration) {
+    Benchmark benchmark(sampleRate, duration);
+    return tune(benchmark, accuracyBudget);
+  }
+
+  /**
+   Obtain the settings to use for a sample rate.
+
+   @param sampleRate the sample rate in use
+   @returns the tuned settings for the sample rate, or `defaults` if there are none
+   */
+  Settings settings(double sampleRate) const {
+    auto found = entries_.find(key(sampleRate));
+    return found == entries_.end() ? defaults : found->second;
+  }
+
+  /**
+   Remember the settings to use for a sample rate.
+
+   @param sampleRate the sample rate the settings were tuned for
+   @param settings the settings to use
+   */
+  void set(double sampleRate, Settings settings) { entries_[key(sampleRate)] = settings; }
+
+  /// @returns true if there are no tuned settings
+  bool empty() const { return entries_.empty(); }
+
+  /**
+   Load settings from a wisdom file. The current settings are only replaced if the whole file is valid.
+
+   @param path the location of the file
+   @returns true if the file was loaded
+   */
+  bool load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::map<long, Settings> entries;
+    bool versionFound = false;
+    bool machineFound = false;
+    std::string line;
+    while (std::getline(file, line)) {
+      if (line.empty() || line[0] == '#') continue;
+      std::istringstream fields(line);
+      std::string tag;
+      fields >> tag;
+      if (tag == "version") {
+        int version = 0;
+        if (!(fields >> version) || version != fileVersion) return false;
+        versionFound = true;
+      }
+      else if (tag == "machine") {
+        std::string machine;
+        std::getline(fields >> std::ws, machine);
+        if (machine != machineSignature()) return false;
+        machineFound = true;
+      }
+      else if (tag == "entry") {
+        long sampleRate = 0;
+        Settings settings{0, 0};
+        if (!(fields >> sampleRate >> settings.samplesPerFilterUpdate >> settings.stepsPerAnchor)) return false;
+        if (sampleRate <= 0 || !isValid(settings)) return false;
+        entries[sampleRate] = settings;
+      }
+      else {
+        return false;
+      }
+    }
+
+    if (!versionFound || !machineFound) return false;
+    entries_ = std::move(entries);
+    return true;
+  }
+
+  /**
+   Save the settings to a wisdom file. The file is written under a temporary name and then renamed, so that a reader
+   never sees a partial file.
+
+   @param path the location of the file
+   @returns true if the file was saved
+   */
+  bool save(const std::string& path) const {
+    auto temporary = path + ".tmp";
+    {
+      std::ofstream file(temporary, std::ios::trunc);
+      if (!file) return false;
+      file << "# SimplyPhaser engine wisdom -- entry <sampleRate> <samplesPerFilterUpdate> <stepsPerAnchor>\n";
+      file << "version " << fileVersion << '\n';
+      file << "machine " << machineSignature() << '\n';
+      for (auto const& [sampleRate, settings] : entries_) {
+        file << "entry " << sampleRate << ' ' << settings.samplesPerFilterUpdate << ' ' << settings.stepsPerAnchor
+        << '\n';
+      }
+      if (!file.flush()) return false;
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+      std::remove(temporary.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   Obtain the name of the CPU of this machine. Wisdom from a different CPU is not used.
+
+   @returns CPU name
+   */
+  static std::string machineSignature() {
+    char brand[256];
+    size_t size = sizeof(brand);
+    if (sysctlbyname("machdep.cpu.brand_string", brand, &size, nullptr, 0) != 0 || size == 0) return "unknown";
+    return std::string(brand, strnlen(brand, size));
+  }
+
+private:
+
+  static Settings tune(Benchmark& benchmark, double accuracyBudget) {
+    Settings best = defaults;
+    double bestSeconds = std::numeric_limits<double>::max();
+    for (auto samplesPerFilterUpdate : samplesPerFilterUpdateCandidates) {
+      for (auto stepsPerAnchor : stepsPerAnchorCandidates) {
+        Settings candidate{samplesPerFilterUpdate, stepsPerAnchor};
+        if (benchmark.loss(candidate) > accuracyBudget) continue;
+        auto seconds = benchmark.seconds(candidate);
+        if (seconds < bestSeconds) {
+          best = candidate;
+          bestSeconds = seconds;
+        }
+      }
+    }
+    return best;
+  }
+
+  static bool isValid(Settings settings) {
+    return settings.samplesPerFilterUpdate >= 1 && settings.samplesPerFilterUpdate <= 1024 &&
+    settings.stepsPerAnchor >= 1 && settings.stepsPerAnchor <= 65536;
+  }
+
+  static long key(double sampleRate) { return std::lround(sampleRate); }
+
+  std::map<long, Settings> entries_;
+};
@@ -21,8 +21,15 @@ struct InputBuffer {
   void allocateBuffers(AVAudioFormat* format, AUAudioFrameCount maxFrames)
   {
     maxFramesToRender_ = maxFrames;
+    bytesPerFrame_ = format.streamDescription->mBytesPerFrame;
     buffer_ = [[AVAudioPCMBuffer alloc] initWithPCMFormat: format frameCapacity: maxFrames];
     mutableAudioBufferList_ = buffer_.mutableAudioBufferList;
+
+    // Touch every page of the new buffers now so that the first render does not take any page faults.
+    UInt32 byteSize = maxFrames * bytesPerFrame_;
+    for (UInt32 i = 0; i < mutableAudioBufferList_->mNumberBuffers; ++i) {
+      memset(mutableAudioBufferList_->mBuffers[i].mData, 0, byteSize);
+    }
   }
   
   /**
@@ -59,7 +66,7 @@ struct InputBuffer {
    */
   void prepareInputBufferList(AVAudioFrameCount frameCount)
   {
-    UInt32 byteSize = frameCount * sizeof(AUValue);
+    UInt32 byteSize = frameCount * bytesPerFrame_;
     for (UInt32 i = 0; i < mutableAudioBufferList_->mNumberBuffers; ++i) {
       mutableAudioBufferList_->mBuffers[i].mDataByteSize = byteSize;
     }
@@ -68,8 +75,8 @@ struct InputBuffer {
   AudioBufferList* mutableAudioBufferList() const { return mutableAudioBufferList_; }
   
 private:
-  os_log_t logger_ = os_log_create("SimplyFlange", "BufferedInputBus");
   AUAudioFrameCount maxFramesToRender_ = 0;
+  UInt32 bytesPerFrame_ = sizeof(AUValue);
   AVAudioPCMBuffer* buffer_ = nullptr;
   AudioBufferList* mutableAudioBufferList_ = nullptr;
 };
@@ -15,8 +15,10 @@
  
  - doParameterEvent
  - doMIDIEvent
- - doRenderFrames
+ - doRendering
  
+ Samples are passed to `doRendering` in the format of the bus, so it must accept buffers of `AUValue` (float32) and
+ of `double` (float64) samples. The latter lets double-precision hosts skip the conversions around the kernel.
  */
 template <typename T> class KernelEventProcessor {
 public:
@@ -43,6 +45,8 @@ public:
    */
   void startProcessing(AVAudioFormat* format, AUAudioFrameCount maxFramesToRender) {
     inputBuffer_.allocateBuffers(format, maxFramesToRender);
+    doublePrecision_ = format.commonFormat == AVAudioPCMFormatFloat64;
+    bytesPerSample_ = doublePrecision_ ? sizeof(double) : sizeof(AUValue);
   }
   
   /**
@@ -126,11 +130,22 @@ private:
     if (inputs == inputs_ && outputs_ == outputs) return;
     inputs_ = inputs;
     outputs_ = outputs;
-    ins_.clear();
-    outs_.clear();
-    for (size_t channel = 0; channel < inputs->mNumberBuffers; ++channel) {
-      ins_.emplace_back(static_cast<AUValue*>(inputs_->mBuffers[channel].mData));
-      outs_.emplace_back(static_cast<AUValue*>(outputs_->mBuffers[channel].mData));
+    if (doublePrecision_) {
+      setChannelBuffers(doubleIns_, doubleOuts_);
+    }
+    else {
+      setChannelBuffers(ins_, outs_);
+    }
+  }
+  
+  template <typename Sample>
+  void setChannelBuffers(std::vector<Sample const*>& ins, std::vector<Sample*>& outs)
+  {
+    ins.clear();
+    outs.clear();
+    for (size_t channel = 0; channel < inputs_->mNumberBuffers; ++channel) {
+      ins.emplace_back(static_cast<Sample*>(inputs_->mBuffers[channel].mData));
+      outs.emplace_back(static_cast<Sample*>(outputs_->mBuffers[channel].mData));
     }
   }
   
@@ -140,6 +155,8 @@ private:
     outputs_ = nullptr;
     ins_.clear();
     outs_.clear();
+    doubleIns_.clear();
+    doubleOuts_.clear();
   }
   
   AURenderEvent const* renderEventsUntil(AUEventSampleTime now, AURenderEvent const* event)
@@ -173,24 +190,36 @@ private:
         }
         
         // Copy samples from input buffer to output buffer
-        auto in = static_cast<AUValue*>(inputs_->mBuffers[channel].mData) + processedFrameCount;
-        auto out = static_cast<AUValue*>(outputs_->mBuffers[channel].mData) + processedFrameCount;
-        memcpy(out, in, frameCount * sizeof(AUValue));
+        auto in = static_cast<uint8_t*>(inputs_->mBuffers[channel].mData) + processedFrameCount * bytesPerSample_;
+        auto out = static_cast<uint8_t*>(outputs_->mBuffers[channel].mData) + processedFrameCount * bytesPerSample_;
+        memcpy(out, in, frameCount * bytesPerSample_);
       }
       return;
     }
     
+    if (doublePrecision_) {
+      renderSamples(doubleIns_, doubleOuts_, frameCount, processedFrameCount);
+    }
+    else {
+      renderSamples(ins_, outs_, frameCount, processedFrameCount);
+    }
+  }
+  
+  template <typename Sample>
+  void renderSamples(std::vector<Sample const*>& ins, std::vector<Sample*>& outs, AUAudioFrameCount frameCount,
+                     AUAudioFrameCount processedFrameCount)
+  {
     // Setup vectorized buffers for easier handling in C++. Here we assume that this will usually be done once for each
     // render call from Core Audio. If there are a lot of interleaved events, then moving this out to the `setBuffers`
     // routine probably makes sense, though it would require changes to `doRendering` to perform the offsetting with
     // `processedFrameCount`.
     for (size_t channel = 0; channel < inputs_->mNumberBuffers; ++channel) {
-      ins_[channel] = static_cast<AUValue*>(inputs_->mBuffers[channel].mData) + processedFrameCount;
-      outs_[channel] = static_cast<AUValue*>(outputs_->mBuffers[channel].mData) + processedFrameCount;
-      outputs_->mBuffers[channel].mDataByteSize = sizeof(AUValue) * (processedFrameCount + frameCount);
+      ins[channel] = static_cast<Sample*>(inputs_->mBuffers[channel].mData) + processedFrameCount;
+      outs[channel] = static_cast<Sample*>(outputs_->mBuffers[channel].mData) + processedFrameCount;
+      outputs_->mBuffers[channel].mDataByteSize = sizeof(Sample) * (processedFrameCount + frameCount);
     }
     
-    derived_.doRendering(ins_, outs_, frameCount);
+    derived_.doRendering(ins, outs, frameCount);
   }
   
   /// Reference to `this` but in its derived form.
@@ -205,6 +234,14 @@ private:
   std::vector<AUValue const*> ins_;
   /// Vector of AUValue arrays for output samples
   std::vector<AUValue*> outs_;
+  /// Vector of double arrays for input samples when the bus format is float64
+  std::vector<double const*> doubleIns_;
+  /// Vector of double arrays for output samples when the bus format is float64
+  std::vector<double*> doubleOuts_;
+  /// True if the bus format holds float64 samples
+  bool doublePrecision_ = false;
+  /// Number of bytes in one sample of one channel
+  size_t bytesPerSample_ = sizeof(AUValue);
   /// True if input buffers are copied as-is to output buffers
   bool bypassed_ = false;
 };
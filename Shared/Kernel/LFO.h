@@ -3,14 +3,17 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 #include "DSP.h"
+#include "QuadratureOscillator.h"
 
 enum class LFOWaveform { sinusoid, triangle, sawtooth };
 
 /**
  Implementation of a low-frequency oscillator. Can generate:
  
- - (pseudo) sinusoid -- uses a parabolic equation that generates very good approximate values for the sin function
+ - sinusoid -- uses a `QuadratureOscillator` that follows the phase of the LFO, so the values and their quad-phase
+   partners are exact and cost a few multiplies per sample
  - triangle -- positive and negative sloped ramps with discontinuous transitions at -1.0 and +1
  - sawtooth -- positive-only ramp with discontinuous transition from 1.0 to -1.0
  
@@ -18,12 +21,23 @@ enum class LFOWaveform { sinusoid, triangle, sawtooth };
  90° out of phase of the main value: when the main value is 0.0 this "quadrature phase" or quad-phase value would be
  0.25. Externally however, the LFO emits bipolar values, oscillating between -1.0 and 1.0.
  
+ The phase is kept in a 64-bit integer where a full cycle spans the whole integer range. Advancing the phase is a
+ plain integer add that wraps on overflow, so there are no branches, no rounding errors that add up over long runs,
+ and the quad phase is just a constant offset of a quarter of the range. The sinusoid oscillator is put back onto this
+ exact phase whenever the phase is set and every `sineAnchorInterval` samples.
+ 
  Loosely based on code found in "Designing Audio Effect Plugins in C++" by Will C. Pirkle (2019)
  */
 template <typename T>
 class LFO {
 public:
   
+  /// Type of the phase accumulator. A full cycle spans the whole range, so the phase wraps by plain integer overflow.
+  using Phase = uint64_t;
+  
+  /// Number of samples between re-anchoring the sinusoid oscillator to the exact phase
+  static constexpr int sineAnchorInterval = 4096;
+  
   /**
    Create a new instance.
    
@@ -32,7 +46,8 @@ public:
    @param waveform the waveform to emit
    */
   LFO(T sampleRate, T frequency, LFOWaveform waveform)
-  : sampleRate_{sampleRate}, frequency_{frequency}, valueGenerator_{WaveformGenerator(waveform)} {
+  : sampleRate_{sampleRate}, frequency_{frequency}, valueGenerator_{WaveformGenerator(waveform)},
+  sinusoid_{waveform == LFOWaveform::sinusoid}, sine_{sampleRate, frequency} {
     reset();
   }
   
@@ -63,7 +78,11 @@ public:
    
    @param waveform the waveform to emit
    */
-  void setWaveform(LFOWaveform waveform) { valueGenerator_ = WaveformGenerator(waveform); }
+  void setWaveform(LFOWaveform waveform) {
+    valueGenerator_ = WaveformGenerator(waveform);
+    sinusoid_ = waveform == LFOWaveform::sinusoid;
+    anchorSine();
+  }
   
   /**
    Set the frequency of the oscillator.
@@ -72,15 +91,19 @@ public:
    */
   void setFrequency(T frequency) {
     frequency_ = frequency;
-    phaseIncrement_ = frequency_ / sampleRate_;
+    phaseIncrement_ = toPhase(double(frequency_) / double(sampleRate_));
+    sine_.setFrequency(frequency_);
   }
   
   /**
    Restart from a known zero state.
    */
   void reset() {
-    phaseIncrement_ = frequency_ / sampleRate_;
-    moduloCounter_ = phaseIncrement_ > 0 ? 0.0 : 1.0;
+    phaseIncrement_ = toPhase(double(frequency_) / double(sampleRate_));
+    phase_ = 0;
+    quadPhase_ = quarterPhase;
+    sine_.initialize(sampleRate_, frequency_);
+    anchorSine();
   }
   
   /**
@@ -88,24 +111,47 @@ public:
    
    @returns current internal state
    */
-  T saveState() const { return moduloCounter_; }
+  Phase saveState() const { return phase_; }
   
   /**
    Restore the oscillator to a previously-saved state.
    
    @param value the state to restore to
    */
-  void restoreState(T value) {
-    moduloCounter_ = value;
-    quadPhaseCounter_ = incrementModuloCounter(value, 0.25);
+  void restoreState(Phase value) {
+    phase_ = value;
+    quadPhase_ = value + quarterPhase;
+    anchorSine();
   }
   
+  /**
+   Obtain the phase of the oscillator as a fraction of a cycle.
+   
+   @returns current phase in the range [0, 1)
+   */
+  T phase() const { return toUnit(phase_); }
+  
+  /**
+   Set the phase of the oscillator from a fraction of a cycle. Values outside of [0, 1) wrap around.
+   
+   @param value the phase to use
+   */
+  void setPhase(double value) { restoreState(toPhase(value)); }
+  
+  /**
+   Move the oscillator ahead as if `increment` were called a number of times.
+   
+   @param sampleCount the number of samples to move ahead
+   */
+  void advance(uint32_t sampleCount) { restoreState(phase_ + phaseIncrement_ * Phase(sampleCount)); }
+  
   /**
    Increment the oscillator to the next value.
    */
   void increment() {
-    moduloCounter_ = incrementModuloCounter(moduloCounter_, phaseIncrement_);
-    quadPhaseCounter_ = incrementModuloCounter(moduloCounter_, 0.25);
+    phase_ += phaseIncrement_;
+    quadPhase_ = phase_ + quarterPhase;
+    if (sinusoid_) incrementSine();
   }
   
   /**
@@ -114,10 +160,15 @@ public:
    @returns current waveform value
    */
   T valueAndIncrement() {
-    auto counter = moduloCounter_;
-    quadPhaseCounter_ = incrementModuloCounter(counter, 0.25);
-    moduloCounter_ = incrementModuloCounter(counter, phaseIncrement_);
-    return valueGenerator_(counter);
+    if (sinusoid_) {
+      auto value = sine_.value();
+      increment();
+      return value;
+    }
+    auto counter = phase_;
+    quadPhase_ = counter + quarterPhase;
+    phase_ = counter + phaseIncrement_;
+    return valueGenerator_(toUnit(counter));
   }
   
   /**
@@ -125,18 +176,35 @@ public:
    
    @returns current waveform value
    */
-  T value() { return valueGenerator_(moduloCounter_); }
+  T value() { return sinusoid_ ? sine_.value() : valueGenerator_(toUnit(phase_)); }
   
   /**
    Obtain the current value of the oscillator that is 90° advanced from what `value()` would return.
    
    @returns current 90° advanced waveform value
    */
-  T quadPhaseValue() const { return valueGenerator_(quadPhaseCounter_); }
+  T quadPhaseValue() const { return sinusoid_ ? sine_.quadPhaseValue() : valueGenerator_(toUnit(quadPhase_)); }
+  
+  /**
+   Convert a fraction of a cycle into a phase value. Values outside of [0, 1) wrap around, so negative values give
+   phases that count backwards.
+   
+   @param value the fraction of a cycle
+   @returns the phase value
+   */
+  static Phase toPhase(double value) {
+    value -= std::floor(value);
+    // Scale to 63 bits so that a value that rounds up to 1.0 cannot overflow the conversion; the shift then wraps it
+    // to 0.
+    return Phase(value * 9223372036854775808.0) << 1;
+  }
   
 private:
   using ValueGenerator = std::function<T(T)>;
   
+  /// One quarter of a cycle
+  static constexpr Phase quarterPhase = Phase(1) << 62;
+  
   static ValueGenerator WaveformGenerator(LFOWaveform waveform) {
     switch (waveform) {
       case LFOWaveform::sinusoid: return sineValue;
@@ -145,21 +213,37 @@ private:
     }
   }
   
-  static T wrappedModuloCounter(T counter, T inc) {
-    if (inc > 0 && counter >= 1.0) return counter - 1.0;
-    if (inc < 0 && counter <= 0.0) return counter + 1.0;
-    return counter;
-  }
+  /// Convert a phase value into a fraction of a cycle. Only the top 53 bits are used so that the result is exact and
+  /// never rounds up to 1.0.
+  static T toUnit(Phase phase) { return T(double(phase >> 11) * 0x1p-53); }
   
-  static T incrementModuloCounter(T counter, T inc) { return wrappedModuloCounter(counter + inc, inc); }
   static T sineValue(T counter) { return DSP::parabolicSine(M_PI - counter * 2.0 * M_PI); }
+  
+  /// Put the sinusoid oscillator on the exact phase of the LFO.
+  void anchorSine() {
+    if (!sinusoid_) return;
+    sine_.setPhase(double(phase_ >> 11) * 0x1p-53);
+    samplesUntilSineAnchor_ = sineAnchorInterval;
+  }
+  
+  void incrementSine() {
+    if (--samplesUntilSineAnchor_ == 0) {
+      anchorSine();
+    }
+    else {
+      sine_.increment();
+    }
+  }
   static T sawtoothValue(T counter) { return DSP::unipolarToBipolar(counter); }
   static T triangleValue(T counter) { return DSP::unipolarToBipolar(std::abs(DSP::unipolarToBipolar(counter))); }
   
   T sampleRate_;
   T frequency_;
   std::function<T(T)> valueGenerator_;
-  T moduloCounter_ = {0.0};
-  T quadPhaseCounter_ = {0.0};
-  T phaseIncrement_;
+  bool sinusoid_;
+  QuadratureOscillator<T> sine_;
+  int samplesUntilSineAnchor_{sineAnchorInterval};
+  Phase phase_{0};
+  Phase quadPhase_{quarterPhase};
+  Phase phaseIncrement_{0};
 };
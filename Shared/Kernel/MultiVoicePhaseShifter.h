@@ -0,0 +1,216 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#pragma once
+
+#import <algorithm>
+#import <array>
+#import <cmath>
+#import <limits>
+#import <vector>
+
+#import "Biquad.h"
+#import "DSP.h"
+#import "PhaseShifter.h"
+
+/**
+ Phase shifter that runs up to `MaxVoices` independent voices over the same input signal and sums their outputs, for a
+ thick "ensemble" phasing effect from one instance. Each voice has its own modulation value and its frequency bands are
+ scaled by a per-voice factor so that the voices do not line up.
+
+ The all-pass filter state and coefficients are stored voice-minor -- `[filter][voice]` -- so every step of the cascade
+ is a loop of fixed length `MaxVoices` over contiguous values that the compiler turns into SIMD operations. Inactive
+ voices ride along in unused lanes with a zero output weight, so the cost grows much slower than the voice count.
+
+ The filters are the same 1-pole all-pass (APF1) filters that `PhaseShifter` uses, and with one voice and no band
+ scaling the output is identical to that of `PhaseShifter`.
+ */
+template <typename T, int MaxVoices = 4>
+class MultiVoicePhaseShifter {
+public:
+  using FrequencyBands = typename PhaseShifter<T>::FrequencyBands;
+  using Lanes = std::array<T, MaxVoices>;
+
+  /// Total span in octaves of the band scaling applied across the voices
+  static constexpr T bandSpreadOctaves = 0.5;
+
+  /**
+   Construct new multi-voice phase-shift operator.
+
+   @param bands the frequency bands to operate over
+   @param sampleRate the sample rate to work with
+   @param intensity a "gain" value that is applied to final filter value
+   @param samplesPerFilterUpdate number of sample values to emit before updating the filter parameters
+   @param stepsPerAnchor number of incremental coefficient updates before they are recalculated exactly
+   */
+  MultiVoicePhaseShifter(const FrequencyBands& bands, T sampleRate, T intensity, int samplesPerFilterUpdate = 10,
+                         int stepsPerAnchor = 64)
+  : bands_(bands), sampleRate_{sampleRate}, intensity_{intensity}, samplesPerFilterUpdate_{samplesPerFilterUpdate},
+  alphas_(bands.size()), states_(bands.size()), gammas_(bands.size() + 1), octaves_(bands.size(), 0.0),
+  updaters_(bands.size() * MaxVoices, Biquad::APF1Updater<T>(sampleRate, stepsPerAnchor))
+  {
+    for (auto index = 0; index < bands_.size(); ++index) {
+      octaves_[index] = std::log2(bands_[index].frequencyMax / bands_[index].frequencyMin);
+    }
+    setVoiceCount(1);
+    reset();
+  }
+
+  /**
+   Set the number of active voices. Each voice has its bands scaled so that the voices are spread evenly over
+   `bandSpreadOctaves`.
+
+   @param voiceCount the number of voices to render (1 to MaxVoices)
+   */
+  void setVoiceCount(int voiceCount) {
+    voiceCount_ = std::clamp(voiceCount, 1, MaxVoices);
+    for (auto voice = 0; voice < MaxVoices; ++voice) {
+      T offset = voiceCount_ == 1 ? 0.0 : (T(voice) / (voiceCount_ - 1) - 0.5) * bandSpreadOctaves;
+      bandScales_[voice] = voice < voiceCount_ ? std::exp2(offset) : 1.0;
+      weights_[voice] = voice < voiceCount_ ? 1.0 / voiceCount_ : 0.0;
+    }
+    appliedModulations_.fill(std::numeric_limits<T>::quiet_NaN());
+  }
+
+  /// @returns the number of active voices
+  int voiceCount() const { return voiceCount_; }
+
+  /**
+   Set the intensity (gain) value.
+
+   @param intensity new value to use
+   */
+  void setIntensity(double intensity) { intensity_ = intensity; }
+
+  /**
+   Set the way modulation values map to frequencies in the bands (see `PhaseShifter::setExponentialSweep`).
+
+   @param enabled true for exponential sweep
+   */
+  void setExponentialSweep(bool enabled) {
+    exponentialSweep_ = enabled;
+    appliedModulations_.fill(std::numeric_limits<T>::quiet_NaN());
+  }
+
+  /**
+   Reset the audio processor. As with `PhaseShifter::reset`, the coefficient updaters start over as well.
+   */
+  void reset() {
+    sampleCounter_ = 0;
+    for (auto& state : states_) state.fill(0.0);
+    for (auto& updater : updaters_) updater.reset();
+    appliedModulations_.fill(std::numeric_limits<T>::quiet_NaN());
+    updateCoefficients([](int voice) { return T(0.0); });
+  }
+
+  /**
+   Generate a new audio sample.
+
+   @param modulation callable that returns the modulation amount for a given voice. Only invoked when the filter
+   coefficients are updated.
+   @param input the audio input signal to inject into the filters
+   @returns the mix of the filtered outputs of the voices
+   */
+  template <typename Modulation>
+  T process(Modulation&& modulation, T input) {
+    if (sampleCounter_++ >= samplesPerFilterUpdate_) {
+      updateCoefficients(modulation);
+      sampleCounter_ = 1;
+    }
+
+    auto filterCount = states_.size();
+
+    // Calculate weighted state sum of past values to mix with input
+    Lanes weightedSum;
+    weightedSum.fill(0.0);
+    for (auto index = 0; index < filterCount; ++index) {
+      auto const& gamma = gammas_[filterCount - index - 1];
+      auto const& state = states_[index];
+      for (auto voice = 0; voice < MaxVoices; ++voice) weightedSum[voice] += gamma[voice] * state[voice];
+    }
+
+    Lanes output;
+    auto const& gamma = gammas_.back();
+    for (auto voice = 0; voice < MaxVoices; ++voice) {
+      output[voice] = (input + intensity_ * weightedSum[voice]) / (1.0 + intensity_ * gamma[voice]);
+    }
+
+    // Apply the filters in series, all voices at once
+    for (auto index = 0; index < filterCount; ++index) {
+      auto const& alpha = alphas_[index];
+      auto& state = states_[index];
+      for (auto voice = 0; voice < MaxVoices; ++voice) {
+        T value = forceMinToZero(alpha[voice] * output[voice] + state[voice]);
+        state[voice] = forceMinToZero(output[voice] - alpha[voice] * value);
+        output[voice] = value;
+      }
+    }
+
+    T sum = 0.0;
+    for (auto voice = 0; voice < MaxVoices; ++voice) sum += weights_[voice] * output[voice];
+    return sum;
+  }
+
+  /**
+   Determine if the filter state holds only finite values (see `PhaseShifter::isFinite`).
+
+   @returns true if there are no NaN or Inf values in the filter state
+   */
+  bool isFinite() const {
+    T sum = 0.0;
+    for (auto const& state : states_) {
+      for (auto voice = 0; voice < MaxVoices; ++voice) sum += state[voice];
+    }
+    return std::isfinite(sum);
+  }
+
+private:
+
+  static T forceMinToZero(T value) { return std::abs(value) < std::numeric_limits<float>::min() ? 0.0 : value; }
+
+  template <typename Modulation>
+  void updateCoefficients(Modulation&& modulation) {
+    T nyquistLimit = sampleRate_ * 0.49;
+    bool changed = false;
+    for (auto voice = 0; voice < voiceCount_; ++voice) {
+      T value = modulation(voice);
+      if (value == appliedModulations_[voice]) continue;
+      appliedModulations_[voice] = value;
+      changed = true;
+      T clamped = std::clamp<T>(value, -1.0, 1.0);
+      for (auto index = 0; index < bands_.size(); ++index) {
+        auto const& band = bands_[index];
+        T frequency = exponentialSweep_
+        ? band.frequencyMin * DSP::fastExp2<T>(DSP::bipolarToUnipolar(clamped) * octaves_[index])
+        : DSP::bipolarModulation(clamped, band.frequencyMin, band.frequencyMax);
+        frequency = std::min(frequency * bandScales_[voice], nyquistLimit);
+        alphas_[index][voice] = updaters_[index * MaxVoices + voice](frequency).a0;
+      }
+    }
+
+    // The gamma values only depend on the coefficients, so calculate them here instead of for every sample.
+    if (!changed) return;
+    auto filterCount = alphas_.size();
+    gammas_[0].fill(1.0);
+    for (auto index = 1; index <= filterCount; ++index) {
+      for (auto voice = 0; voice < MaxVoices; ++voice) {
+        gammas_[index][voice] = alphas_[filterCount - index][voice] * gammas_[index - 1][voice];
+      }
+    }
+  }
+
+  const FrequencyBands& bands_;
+  T sampleRate_;
+  T intensity_;
+  int samplesPerFilterUpdate_;
+  int sampleCounter_{0};
+  int voiceCount_{1};
+  std::vector<Lanes> alphas_;
+  std::vector<Lanes> states_;
+  std::vector<Lanes> gammas_;
+  std::vector<T> octaves_;
+  std::vector<Biquad::APF1Updater<T>> updaters_;
+  Lanes bandScales_;
+  Lanes weights_;
+  Lanes appliedModulations_;
+  bool exponentialSweep_{false};
+};
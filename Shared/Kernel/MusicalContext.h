@@ -0,0 +1,70 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#pragma once
+
+#include <array>
+#include <cmath>
+
+/**
+ Tempo and song position reported by the host for the first sample of a render call. On Apple platforms this comes
+ from the AUHostMusicalContextBlock, but any host harness can fill it in.
+
+ Tempo-synced LFO rates are given in beats per LFO cycle. Instead of accumulating phase for every sample over the
+ length of a session, the LFO phase is computed from the beat position once per render block, so all instances that
+ share a host timeline stay locked to the song grid and to each other.
+ */
+struct MusicalContext {
+
+  /// Beats per LFO cycle for each value of the sync parameter. Index 0 is reserved for the free-running (Hz) rate.
+  static constexpr std::array<double, 8> syncBeatsPerCycle = {
+    0.0,  // free
+    16.0, // 4 bars
+    8.0,  // 2 bars
+    4.0,  // 1 bar
+    2.0,  // 1/2
+    1.0,  // 1/4
+    0.5,  // 1/8
+    0.25  // 1/16
+  };
+
+  /// Tempo in beats per minute. Zero when the host does not provide a musical context.
+  double tempo = 0.0;
+  /// Position in beats of the first sample of the render call
+  double beatPosition = 0.0;
+  /// True if the host transport is moving. When it is stopped the beat position stands still, so it is of no use for
+  /// placing the LFO phase. Hosts that do not report their transport state are taken to be moving.
+  bool transportMoving = true;
+
+  /// @returns true if the host provided a tempo
+  bool isValid() const { return tempo > 0.0; }
+
+  /**
+   Obtain the beat position of a sample that is some number of frames after the first one of the render call.
+
+   @param frames the offset of the sample from the start of the render call
+   @param sampleRate the sample rate in use
+   @returns the beat position of the sample
+   */
+  double beatsAt(double frames, double sampleRate) const { return beatPosition + frames * tempo / (60.0 * sampleRate); }
+
+  /**
+   Obtain the LFO frequency for a given tempo-synced rate.
+
+   @param beatsPerCycle the number of beats in one LFO cycle
+   @returns frequency in Hz
+   */
+  double frequency(double beatsPerCycle) const { return tempo / (60.0 * beatsPerCycle); }
+
+  /**
+   Obtain the LFO phase for a beat position.
+
+   @param beats the beat position
+   @param beatsPerCycle the number of beats in one LFO cycle
+   @returns phase in the range [0, 1)
+   */
+  static double phase(double beats, double beatsPerCycle) {
+    double cycles = beats / beatsPerCycle;
+    double phase = cycles - std::floor(cycles);
+    return phase < 1.0 ? phase : 0.0;
+  }
+};
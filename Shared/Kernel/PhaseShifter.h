@@ -3,6 +3,7 @@
 #pragma once
 
 #import <algorithm>
+#import <limits>
 #import <vector>
 
 #import "Biquad.h"
@@ -57,11 +58,18 @@ public:
    @param sampleRate the sample rate to work with
    @param intensity a "gain" value that is applied to final filter value
    @param samplesPerFilterUpdate number of sample values to emit before updating the filter parameters
+   @param stepsPerAnchor number of incremental coefficient updates before they are recalculated exactly
    */
-  PhaseShifter(const FrequencyBands& bands, T sampleRate, T intensity, int samplesPerFilterUpdate = 10)
+  PhaseShifter(const FrequencyBands& bands, T sampleRate, T intensity, int samplesPerFilterUpdate = 10,
+               int stepsPerAnchor = 64)
   : bands_(bands), sampleRate_{sampleRate}, intensity_{intensity}, samplesPerFilterUpdate_{samplesPerFilterUpdate},
-  filters_(bands_.size(), AllPassFilter()), gammas_(bands.size() + 1, 1.0)
+  filters_(bands_.size(), AllPassFilter()),
+  updaters_(bands_.size(), Biquad::APF1Updater<T>(sampleRate, stepsPerAnchor)),
+  gammas_(bands.size() + 1, 1.0), octaves_(bands.size(), 0.0)
   {
+    for (auto index = 0; index < bands_.size(); ++index) {
+      octaves_[index] = std::log2(bands_[index].frequencyMax / bands_[index].frequencyMin);
+    }
     updateCoefficients(0.0);
   }
   
@@ -71,15 +79,65 @@ public:
    @param intensity new value to use
    */
   void setIntensity(double intensity) { intensity_ = intensity; }
+
+  /**
+   Set the way modulation values map to frequencies in the bands. When true, the sweep is exponential so that equal
+   modulation steps cover equal musical intervals; when false the sweep is linear in Hz.
+
+   @param enabled true for exponential sweep
+   */
+  void setExponentialSweep(bool enabled) {
+    exponentialSweep_ = enabled;
+    appliedModulation_ = std::numeric_limits<T>::quiet_NaN();
+  }
   
   /**
-   Reset the audio processor.
+   Reset the audio processor. The coefficient updaters start over as well, so that rendering after a reset produces
+   the same samples as a new instance.
    */
   void reset() {
     sampleCounter_ = 0;
     for (auto& filter : filters_) {
       filter.reset();
     }
+    for (auto& updater : updaters_) {
+      updater.reset();
+    }
+    updateCoefficients(0.0);
+  }
+  
+  /**
+   Make the filter state identical to that of another instance using the same frequency bands. Used to keep the
+   shifters of channels carrying the same audio in lock-step while only one of them does the processing.
+
+   @param other the instance to copy from
+   */
+  void copyState(const PhaseShifter<T>& other) {
+    assert(filters_.size() == other.filters_.size());
+    sampleCounter_ = other.sampleCounter_;
+    filters_ = other.filters_;
+    updaters_ = other.updaters_;
+    gammas_ = other.gammas_;
+    appliedModulation_ = other.appliedModulation_;
+  }
+
+  /**
+   Determine if the state of another instance using the same frequency bands is identical to this one, so that both
+   produce the same samples from the same input and modulation. The APF1 filters hold one state value each, and their
+   coefficients all derive from the gain value.
+
+   @param other the instance to compare with
+   @returns true if the states are identical
+   */
+  bool sameState(const PhaseShifter<T>& other) const {
+    assert(filters_.size() == other.filters_.size());
+    if (sampleCounter_ != other.sampleCounter_ || appliedModulation_ != other.appliedModulation_ ||
+        gammas_ != other.gammas_ || updaters_ != other.updaters_) return false;
+    for (auto index = 0; index < filters_.size(); ++index) {
+      if (filters_[index].storageComponent() != other.filters_[index].storageComponent() ||
+          filters_[index].gainValue() != other.filters_[index].gainValue()) return false;
+    }
+    return true;
   }
   
   /**
@@ -92,18 +150,14 @@ public:
   T process(T modulation, T input) {
     
     // With samplersPerFilterUpdate_ == 1, this replicates the phaser processing described in
-    // "Designing Audio Effect Plugins in C++" by Will C. Pirkle (2019).
+    // "Designing Audio Effect Plugins in C++" by Will C. Pirkle (2019). When the modulation does not change (depth of
+    // zero), the coefficients and gamma values stay as they are.
     //
     if (sampleCounter_++ >= samplesPerFilterUpdate_) {
-      updateCoefficients(modulation);
+      if (modulation != appliedModulation_) updateCoefficients(modulation);
       sampleCounter_ = 1;
     }
     
-    // Calculate gamma values from the individual filters.
-    for (auto index = 1; index <= filters_.size(); ++index) {
-      gammas_[index] = filters_[filters_.size() - index].gainValue() * gammas_[index - 1];
-    }
-    
     // Calculate weighted state sum of past values to mix with input
     T weightedSum = 0.0;
     for (auto index = 0; index < filters_.size(); ++index) {
@@ -118,15 +172,74 @@ public:
     
     return output;
   }
-  
+
+  /**
+   Obtain the frequency of a filter for a modulation value, using the current sweep mapping. Modulation values outside
+   of [-1, 1] are clamped for both mappings.
+
+   @param index the index of the filter
+   @param modulation the modulation value
+   @returns the filter frequency in Hz
+   */
+  T frequency(size_t index, T modulation) const {
+    auto const& band = bands_[index];
+    T clamped = std::clamp<T>(modulation, -1.0, 1.0);
+    return exponentialSweep_
+    ? band.frequencyMin * DSP::fastExp2<T>(DSP::bipolarToUnipolar(clamped) * octaves_[index])
+    : DSP::bipolarModulation(clamped, band.frequencyMin, band.frequencyMax);
+  }
+
+  /**
+   Obtain the largest magnitude held in the filter states. Useful for detecting drift or denormal creep over long runs.
+
+   @returns max absolute state value
+   */
+  T stateMagnitude() const {
+    T magnitude = 0.0;
+    for (auto const& filter : filters_) {
+      magnitude = std::max(magnitude, std::abs(filter.storageComponent()));
+    }
+    return magnitude;
+  }
+
+  /**
+   Determine if any of the filter states holds a subnormal value. Arithmetic on subnormals is very slow on most CPUs,
+   so they should never linger in the feedback path.
+
+   @returns true if a subnormal value is found
+   */
+  bool hasSubnormalState() const {
+    return std::any_of(filters_.begin(), filters_.end(), [](auto const& filter) {
+      return std::fpclassify(filter.storageComponent()) == FP_SUBNORMAL;
+    });
+  }
+
+  /**
+   Determine if the filter state holds only finite values. A NaN or Inf input latches into the filter state through the
+   feedback path and stays there until `reset` is called. This is cheap enough to check once per render block.
+
+   @returns true if there are no NaN or Inf values in the filter state
+   */
+  bool isFinite() const {
+    T sum = 0.0;
+    for (auto const& filter : filters_) {
+      sum += filter.storageComponent();
+    }
+    return std::isfinite(sum);
+  }
+
 private:
   
   void updateCoefficients(T modulation) {
     assert(filters_.size() == bands_.size());
     for (auto index = 0; index < filters_.size(); ++index) {
-      auto const& band = bands_[index];
-      double frequency = DSP::bipolarModulation(modulation, band.frequencyMin, band.frequencyMax);
-      filters_[index].setCoefficients(Biquad::Coefficients<T>::APF1(sampleRate_, frequency));
+      filters_[index].setCoefficients(updaters_[index](frequency(index, modulation)));
+    }
+    appliedModulation_ = modulation;
+    
+    // Calculate gamma values from the individual filters. These only depend on the coefficients.
+    for (auto index = 1; index <= filters_.size(); ++index) {
+      gammas_[index] = filters_[filters_.size() - index].gainValue() * gammas_[index - 1];
     }
   }
   
@@ -136,7 +249,9 @@ private:
   int samplesPerFilterUpdate_;
   int sampleCounter_{0};
   std::vector<AllPassFilter> filters_;
+  std::vector<Biquad::APF1Updater<T>> updaters_;
   std::vector<T> gammas_;
-  
-  os_log_t log_ = os_log_create("PhaseShifter", "SimplyPhaserKernel");
+  std::vector<T> octaves_;
+  T appliedModulation_{0.0};
+  bool exponentialSweep_{false};
 };
@@ -0,0 +1,168 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+/**
+ Sinusoidal oscillator that generates sin and cos values together using a coupled-form (rotation) recurrence. Each step
+ rotates the (cos, sin) vector by a fixed angle, which costs four multiplies and two adds per sample and yields exact
+ sine values (within rounding) instead of the ~0.0011 worst-case error of `DSP::parabolicSine`. The 90° advanced value
+ needed for quad-phase operation is just the cosine term, so it comes for free.
+
+ Rounding errors slowly change the magnitude of the rotating vector, so it is periodically pulled back to the unit
+ circle with a first-order Newton step that costs a few multiplies.
+
+ `LFO` uses this to generate its `LFOWaveform::sinusoid` values: `value()` starts at 0.0 and rises to 1.0 a quarter
+ period later, and `quadPhaseValue()` is 90° advanced from it.
+ */
+template <typename T>
+class QuadratureOscillator {
+public:
+
+  /// Number of samples between renormalizations of the rotating vector
+  static constexpr int renormalizationInterval = 64;
+
+  /**
+   Create a new instance.
+
+   @param sampleRate number of samples per second
+   @param frequency the frequency of the oscillator
+   */
+  QuadratureOscillator(T sampleRate, T frequency) : sampleRate_{sampleRate} {
+    setFrequency(frequency);
+    reset();
+  }
+
+  /**
+   Create a new instance.
+   */
+  QuadratureOscillator() : QuadratureOscillator(44100.0, 1.0) {}
+
+  /**
+   Initialize the oscillator with the given parameters.
+
+   @param sampleRate number of samples per second
+   @param frequency the frequency of the oscillator
+   */
+  void initialize(T sampleRate, T frequency) {
+    sampleRate_ = sampleRate;
+    setFrequency(frequency);
+    reset();
+  }
+
+  /**
+   Set the frequency of the oscillator. The current phase is retained.
+
+   @param frequency the frequency to operate at
+   */
+  void setFrequency(T frequency) {
+    frequency_ = frequency;
+    double theta = 2.0 * M_PI * frequency_ / sampleRate_;
+    cosDelta_ = std::cos(theta);
+    sinDelta_ = std::sin(theta);
+  }
+
+  /**
+   Restart from a known zero state.
+   */
+  void reset() { setPhase(0.0); }
+
+  /**
+   Move the oscillator to a phase given as a fraction of a cycle. This evaluates `std::sin` and `std::cos` once, so it
+   is also the way to pull the oscillator back onto an exact phase after a long run.
+
+   @param phase the phase to use, where 1.0 is a full cycle
+   */
+  void setPhase(double phase) {
+    double theta = 2.0 * M_PI * phase;
+    sin_ = std::sin(theta);
+    cos_ = std::cos(theta);
+    samplesUntilRenormalization_ = renormalizationInterval;
+  }
+
+  /**
+   Increment the oscillator to the next value.
+   */
+  void increment() {
+    T sin = sin_ * cosDelta_ + cos_ * sinDelta_;
+    T cos = cos_ * cosDelta_ - sin_ * sinDelta_;
+    sin_ = sin;
+    cos_ = cos;
+    if (--samplesUntilRenormalization_ == 0) renormalize();
+  }
+
+  /**
+   Obtain the next value of the oscillator. Advances the oscillator before returning, so this is not idempotent.
+
+   @returns current waveform value
+   */
+  T valueAndIncrement() {
+    T value = sin_;
+    increment();
+    return value;
+  }
+
+  /**
+   Obtain the current value of the oscillator.
+
+   @returns current waveform value
+   */
+  T value() const { return sin_; }
+
+  /**
+   Obtain the current value of the oscillator that is 90° advanced from what `value()` would return.
+
+   @returns current 90° advanced waveform value
+   */
+  T quadPhaseValue() const { return cos_; }
+
+  /**
+   Fill buffers with the next `count` values of the oscillator, advancing the oscillator by the same amount.
+
+   @param values the buffer to hold the `value()` samples
+   @param quadPhaseValues the buffer to hold the `quadPhaseValue()` samples (may be null)
+   @param count the number of samples to generate
+   */
+  void fill(T* values, T* quadPhaseValues, size_t count) {
+    T sin = sin_;
+    T cos = cos_;
+    int remaining = samplesUntilRenormalization_;
+    for (size_t index = 0; index < count; ++index) {
+      values[index] = sin;
+      if (quadPhaseValues != nullptr) quadPhaseValues[index] = cos;
+      T nextSin = sin * cosDelta_ + cos * sinDelta_;
+      cos = cos * cosDelta_ - sin * sinDelta_;
+      sin = nextSin;
+      if (--remaining == 0) {
+        T gain = magnitudeCorrection(sin, cos);
+        sin *= gain;
+        cos *= gain;
+        remaining = renormalizationInterval;
+      }
+    }
+    sin_ = sin;
+    cos_ = cos;
+    samplesUntilRenormalization_ = remaining;
+  }
+
+private:
+
+  static T magnitudeCorrection(T sin, T cos) { return 1.5 - 0.5 * (sin * sin + cos * cos); }
+
+  void renormalize() {
+    T gain = magnitudeCorrection(sin_, cos_);
+    sin_ *= gain;
+    cos_ *= gain;
+    samplesUntilRenormalization_ = renormalizationInterval;
+  }
+
+  T sampleRate_;
+  T frequency_;
+  T cosDelta_;
+  T sinDelta_;
+  T sin_;
+  T cos_;
+  int samplesUntilRenormalization_;
+};
@@ -2,14 +2,27 @@
 
 #pragma once
 
+#import <algorithm>
+#import <array>
+#import <atomic>
+#import <chrono>
+#import <map>
+#import <mutex>
 #import <string>
+#import <type_traits>
 #import <AVFoundation/AVFoundation.h>
 #include <dispatch/dispatch.h>
 
 #import "SimplyPhaserFramework/SimplyPhaserFramework-Swift.h"
+#import "AutoGain.h"
+#import "EngineWisdom.h"
 #import "KernelEventProcessor.h"
 #import "LFO.h"
+#import "MultiVoicePhaseShifter.h"
+#import "MusicalContext.h"
 #import "PhaseShifter.h"
+#import "RealtimeLogger.hpp"
+#import "Telemetry.hpp"
 
 /**
  The audio processing kernel that transforms audio samples into those with a phased effect. Note that although it is
@@ -25,9 +38,14 @@ public:
    
    @param name the logging subsystem to use when emitting log statements
    */
-  SimplyPhaserKernel(const std::string& name) : super(os_log_create(name.c_str(), "SimplyPhaserKernel")), lfo_()
+  SimplyPhaserKernel(const std::string& name) : super(sharedLog(name)), lfo_(),
+  logger_(logFormats(), [log = log_](const char* message) {
+    os_log_with_type(log, OS_LOG_TYPE_INFO, "%{public}s", message);
+  })
   {
     lfo_.setWaveform(LFOWaveform::triangle);
+    for (auto& lfo : voiceLFOs_) lfo.setWaveform(LFOWaveform::triangle);
+    rightLFO_.setWaveform(LFOWaveform::triangle);
   }
   
   /**
@@ -47,7 +65,7 @@ public:
   void stopProcessing() { super::stopProcessing(); }
   
   /**
-   Change a runtime parameter value.
+   Change a runtime parameter value. Changes are logged unless parameter logging is off.
    
    @param address the unique address of the parameter to change
    @param value the new value to assign to the parameter
@@ -57,38 +75,97 @@ public:
     switch (address) {
       case FilterParameterAddressRate:
         if (value == rate_) return;
-        // os_log_with_type(log_, OS_LOG_TYPE_INFO, "rate - %f", value);
+        logParameter(logRate, value);
         rate_ = value;
         lfo_.setFrequency(rate_);
+        voiceRatesChanged();
         break;
       case FilterParameterAddressDepth:
         tmp = value / 100.0;
         if (tmp == depth_) return;
-        // os_log_with_type(log_, OS_LOG_TYPE_INFO, "depth - %f", tmp);
+        logParameter(logDepth, tmp);
         depth_ = tmp;
         break;
       case FilterParameterAddressIntensity:
         tmp = value / 100.0;
         if (tmp == intensity_) return;
-        // os_log_with_type(log_, OS_LOG_TYPE_INFO, "intensity - %f", tmp);
+        logParameter(logIntensity, tmp);
         intensity_ = tmp;
         intensityChanged();
         break;
       case FilterParameterAddressDryMix:
         tmp = value / 100.0;
         if (tmp == dryMix_) return;
-        // os_log_with_type(log_, OS_LOG_TYPE_INFO, "dryMix - %f", tmp);
+        logParameter(logDryMix, tmp);
         dryMix_ = tmp;
         break;
       case FilterParameterAddressWetMix:
         tmp = value / 100.0;
         if (tmp == wetMix_) return;
-        // os_log_with_type(log_, OS_LOG_TYPE_INFO, "wetMix - %f", tmp);
+        logParameter(logWetMix, tmp);
         wetMix_ = tmp;
         break;
       case FilterParameterAddressOdd90:
         odd90_ = value > 0 ? true : false;
-        // os_log_with_type(log_, OS_LOG_TYPE_INFO, "odd90 - %d", odd90_);
+        logParameter(logOdd90, odd90_);
+        break;
+      case FilterParameterAddressLogSweep:
+        logSweep_ = value > 0 ? true : false;
+        logParameter(logLogSweep, logSweep_);
+        logSweepChanged();
+        break;
+      case FilterParameterAddressVoices:
+        if (int(value) == voices_) return;
+        voices_ = std::clamp(int(value), 1, maxVoices);
+        logParameter(logVoices, voices_);
+        voicesChanged();
+        break;
+      case FilterParameterAddressSync:
+        if (int(value) == sync_) return;
+        sync_ = std::clamp(int(value), 0, int(MusicalContext::syncBeatsPerCycle.size()) - 1);
+        logParameter(logSync, sync_);
+        break;
+      case FilterParameterAddressUnlinked:
+        unlinked_ = value > 0 ? true : false;
+        logParameter(logUnlinked, unlinked_);
+        intensityChanged();
+        break;
+      case FilterParameterAddressRightRate:
+        if (value == rightRate_) return;
+        logParameter(logRightRate, value);
+        rightRate_ = value;
+        rightLFO_.setFrequency(rightRate_);
+        break;
+      case FilterParameterAddressRightDepth:
+        tmp = value / 100.0;
+        if (tmp == rightDepth_) return;
+        logParameter(logRightDepth, tmp);
+        rightDepth_ = tmp;
+        break;
+      case FilterParameterAddressRightIntensity:
+        tmp = value / 100.0;
+        if (tmp == rightIntensity_) return;
+        logParameter(logRightIntensity, tmp);
+        rightIntensity_ = tmp;
+        intensityChanged();
+        break;
+      case FilterParameterAddressRightDryMix:
+        tmp = value / 100.0;
+        if (tmp == rightDryMix_) return;
+        logParameter(logRightDryMix, tmp);
+        rightDryMix_ = tmp;
+        break;
+      case FilterParameterAddressRightWetMix:
+        tmp = value / 100.0;
+        if (tmp == rightWetMix_) return;
+        logParameter(logRightWetMix, tmp);
+        rightWetMix_ = tmp;
+        break;
+      case FilterParameterAddressAutoGain:
+        if ((value > 0) == autoGainEnabled_) return;
+        autoGainEnabled_ = value > 0;
+        logParameter(logAutoGain, autoGainEnabled_);
+        autoGain_.reset();
         break;
     }
   }
@@ -107,53 +184,631 @@ public:
       case FilterParameterAddressDryMix: return dryMix_ * 100.0;
       case FilterParameterAddressWetMix: return wetMix_ * 100.0;
       case FilterParameterAddressOdd90: return odd90_ ? 1.0 : 0.0;
+      case FilterParameterAddressLogSweep: return logSweep_ ? 1.0 : 0.0;
+      case FilterParameterAddressVoices: return voices_;
+      case FilterParameterAddressSync: return sync_;
+      case FilterParameterAddressUnlinked: return unlinked_ ? 1.0 : 0.0;
+      case FilterParameterAddressRightRate: return rightRate_;
+      case FilterParameterAddressRightDepth: return rightDepth_ * 100.0;
+      case FilterParameterAddressRightIntensity: return rightIntensity_ * 100.0;
+      case FilterParameterAddressRightDryMix: return rightDryMix_ * 100.0;
+      case FilterParameterAddressRightWetMix: return rightWetMix_ * 100.0;
+      case FilterParameterAddressAutoGain: return autoGainEnabled_ ? 1.0 : 0.0;
     }
     return 0.0;
   }
   
+  /**
+   Set the host's musical context for the next render call. When the sync parameter selects a note division and the
+   context has a tempo, the LFO rate follows the tempo, and while the transport is moving the LFO phase is derived
+   from the beat position at the start of each rendered block.
+   
+   @param context the tempo and beat position of the first sample of the render call
+   */
+  void setMusicalContext(const MusicalContext& context) {
+    musicalContext_ = context;
+    contextFrameOffset_ = 0;
+  }
+  
+  /**
+   Obtain the number of times a channel's filter state had to be reset because it held a NaN or Inf value.
+   
+   @returns reset count
+   */
+  uint64_t nonFiniteResetCount() const { return nonFiniteResetCount_.load(std::memory_order_relaxed); }
+  
+  /**
+   Obtain the number of channels whose output is currently copied from the first channel instead of being rendered.
+   
+   @returns mirrored channel count
+   */
+  size_t mirroredChannelCount() const { return std::count(mirroring_.begin(), mirroring_.end(), true); }
+  
+  /**
+   Control the logging of parameter changes. Offline renderers set parameters for every clip or candidate they render
+   and turn it off so that they do not flood the log. On by default.
+   
+   @param enabled true to log parameter changes
+   */
+  void setParameterLogging(bool enabled) { parameterLogging_ = enabled; }
+  
+  /// @returns true if parameter changes are logged
+  bool parameterLogging() const { return parameterLogging_; }
+  
+  /**
+   Obtain the number of log statements that were dropped because the realtime logger could not keep up.
+   
+   @returns drop count
+   */
+  uint64_t droppedLogCount() const { return logger_.droppedCount(); }
+  
+  /**
+   Begin publishing render statistics into the named shared-memory segment for external monitoring (see
+   `Telemetry::Reader`). Must be called after `startProcessing` and not from the render thread, but it is safe to call
+   while rendering.
+   
+   @param segmentName the name of the shared-memory segment (e.g. "/SimplyPhaser")
+   @returns true if publishing is active
+   */
+  bool enableTelemetry(const std::string& segmentName) {
+    return telemetry_.open(segmentName, uint32_t(phaseShifters_.size()), sampleRate_);
+  }
+  
+  /**
+   Stop publishing render statistics. Must not be called from the render thread. When rendering, waits for the render
+   thread to finish publishing the current render, if any.
+   */
+  void disableTelemetry() { telemetry_.close(); }
+
+  /**
+   Use tuned engine settings from a wisdom file (see `EngineWisdom`). The settings take effect at the next
+   `startProcessing`. If the file cannot be used, the kernel keeps the settings it has.
+
+   @param path the location of the wisdom file
+   @returns true if the file was loaded
+   */
+  bool loadWisdom(const std::string& path) { return wisdom_.load(path); }
+  
+  /**
+   Return the kernel to the state it had right after `startProcessing`: all filter state is cleared and the LFO starts
+   over from its initial phase. Parameter values are not changed.
+   */
+  void reset() {
+    lfo_.reset();
+    rightLFO_.reset();
+    autoGain_.reset();
+    
+    // Set the voice counts first so that the filters of all active voices start from the same coefficients.
+    voicesChanged();
+    for (auto& filter : phaseShifters_) {
+      filter.reset();
+    }
+    for (auto& filter : voiceShifters_) {
+      filter.reset();
+    }
+    mirroring_.assign(mirroring_.size(), false);
+  }
+  
+  /**
+   Render a complete clip of audio starting from a reset state, followed by its tail. The tail is rendered from silent
+   input in blocks of `clipBlockSize` frames until the peak output of a block falls below `tailThreshold` or until
+   `maxTailFrames` have been rendered. Each output buffer must have room for `frameCount + maxTailFrames` samples. The
+   samples are either `AUValue` or `double`, as with `doRendering`.
+   
+   @param ins the input buffers, one per channel
+   @param outs the output buffers, one per channel
+   @param frameCount the number of frames in the clip
+   @param maxTailFrames the maximum number of tail frames to render after the clip
+   @param tailThreshold the output level below which the tail is considered done
+   @param lfoPhase the phase of the LFO at the start of the clip, in the range [0, 1)
+   @returns the number of frames written to the output buffers
+   */
+  template <typename Sample>
+  size_t renderClip(const std::vector<Sample const*>& ins, const std::vector<Sample*>& outs, size_t frameCount,
+                    size_t maxTailFrames, AUValue tailThreshold, double lfoPhase = 0.0) {
+    assert(ins.size() == phaseShifters_.size() && outs.size() == phaseShifters_.size());
+    reset();
+    if (lfoPhase != 0.0) {
+      lfo_.setPhase(lfoPhase);
+      rightLFO_.setPhase(lfoPhase);
+      voicesChanged();
+    }
+    renderStream(ins, outs, frameCount);
+    
+    std::vector<Sample*> tailOuts(outs.size());
+    for (size_t channel = 0; channel < outs.size(); ++channel) {
+      tailOuts[channel] = outs[channel] + frameCount;
+    }
+    bool tailDone;
+    return frameCount + renderTail(tailOuts, maxTailFrames, tailThreshold, tailDone);
+  }
+  
+  /**
+   Render one piece of a longer stream of audio offline. Unlike `renderClip`, the kernel state carries over from one
+   call to the next, so a long file can be rendered in pieces. The result is the same as rendering it in one go as long
+   as every piece but the last is a multiple of `clipBlockSize` frames. Call `reset` before the first piece.
+   
+   @param ins the input buffers, one per channel
+   @param outs the output buffers, one per channel
+   @param frameCount the number of frames to render
+   */
+  template <typename Sample>
+  void renderStream(const std::vector<Sample const*>& ins, const std::vector<Sample*>& outs, size_t frameCount) {
+    assert(ins.size() == phaseShifters_.size() && outs.size() == phaseShifters_.size());
+    auto& clip = clipBuffers<Sample>();
+    clip.ins.resize(ins.size());
+    clip.outs.resize(outs.size());
+    size_t position = 0;
+    while (position < frameCount) {
+      auto count = std::min(clipBlockSize, frameCount - position);
+      for (size_t channel = 0; channel < ins.size(); ++channel) {
+        clip.ins[channel] = ins[channel] + position;
+        clip.outs[channel] = outs[channel] + position;
+      }
+      doRendering(clip.ins, clip.outs, AUAudioFrameCount(count));
+      position += count;
+    }
+  }
+  
+  /**
+   Render the tail of the effect after the end of a clip or stream. The tail is rendered from silent input in blocks
+   of `clipBlockSize` frames until the peak output of a block falls below `tailThreshold` or until `maxTailFrames` have
+   been rendered. A tail that is cut off by `maxTailFrames` can be continued with another call.
+   
+   @param outs the output buffers, one per channel. Each must have room for `maxTailFrames` samples.
+   @param maxTailFrames the maximum number of tail frames to render
+   @param tailThreshold the output level below which the tail is considered done
+   @param done set to true if the tail fell below `tailThreshold`, false if it was cut off by `maxTailFrames`
+   @returns the number of frames written to the output buffers
+   */
+  template <typename Sample>
+  size_t renderTail(const std::vector<Sample*>& outs, size_t maxTailFrames, AUValue tailThreshold, bool& done) {
+    assert(outs.size() == phaseShifters_.size());
+    done = false;
+    auto& clip = clipBuffers<Sample>();
+    clip.ins.resize(outs.size());
+    clip.outs.resize(outs.size());
+    if (clip.silence.size() < clipBlockSize) clip.silence.assign(clipBlockSize, 0.0);
+    
+    size_t position = 0;
+    while (position < maxTailFrames) {
+      auto count = std::min(clipBlockSize, maxTailFrames - position);
+      for (size_t channel = 0; channel < outs.size(); ++channel) {
+        clip.ins[channel] = clip.silence.data();
+        clip.outs[channel] = outs[channel] + position;
+      }
+      doRendering(clip.ins, clip.outs, AUAudioFrameCount(count));
+      
+      auto peak = peakLevel(clip.outs, AUAudioFrameCount(count));
+      position += count;
+      if (peak < tailThreshold) {
+        done = true;
+        break;
+      }
+    }
+    
+    return position;
+  }
+  
 private:
   using FloatKind = double;
   
+  /// Max number of voices rendered in multi-voice mode
+  static constexpr int maxVoices = 4;
+  /// Amount by which the LFO rate of each additional voice is increased, as a fraction of the rate
+  static constexpr FloatKind voiceRateSpread = 0.05;
+  
+  /// Identifiers of the format strings used with `logger_`
+  enum LogFormat : uint32_t {
+    logRate,
+    logDepth,
+    logIntensity,
+    logDryMix,
+    logWetMix,
+    logOdd90,
+    logLogSweep,
+    logVoices,
+    logSync,
+    logUnlinked,
+    logRightRate,
+    logRightDepth,
+    logRightIntensity,
+    logRightDryMix,
+    logRightWetMix,
+    logAutoGain,
+    logNonFiniteReset
+  };
+  
+  static std::vector<const char*> logFormats() {
+    return {
+      "rate - %f",
+      "depth - %f",
+      "intensity - %f",
+      "dryMix - %f",
+      "wetMix - %f",
+      "odd90 - %.0f",
+      "logSweep - %.0f",
+      "voices - %.0f",
+      "sync - %.0f",
+      "unlinked - %.0f",
+      "rightRate - %f",
+      "rightDepth - %f",
+      "rightIntensity - %f",
+      "rightDryMix - %f",
+      "rightWetMix - %f",
+      "autoGain - %.0f",
+      "channel %.0f reset after NaN/Inf in filter state"
+    };
+  }
+  
+  template <typename Value>
+  void logParameter(LogFormat format, Value value) {
+    if (parameterLogging_) logger_.log(format, value);
+  }
+  
+  /// Number of frames rendered at a time by `renderClip`
+  static constexpr size_t clipBlockSize = 512;
+  
+  /// Working buffers of the offline rendering methods for one sample type
+  template <typename Sample>
+  struct ClipBuffers {
+    std::vector<Sample const*> ins;
+    std::vector<Sample*> outs;
+    std::vector<Sample> silence;
+  };
+  
+  template <typename Sample>
+  ClipBuffers<Sample>& clipBuffers() {
+    if constexpr (std::is_same_v<Sample, double>) return doubleClipBuffers_;
+    else return floatClipBuffers_;
+  }
+  
+  /**
+   Obtain the log to use for kernel instances with the given subsystem name. Hosts can create hundreds of instances
+   when opening a session, so there is one log handle per name, created by the first instance that uses it.
+   
+   @param name the logging subsystem to use when emitting log statements
+   @returns the shared log handle for the name
+   */
+  static os_log_t sharedLog(const std::string& name) {
+    static std::mutex mutex;
+    static std::map<std::string, os_log_t> logs;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = logs.find(name);
+    if (found == logs.end()) found = logs.emplace(name, os_log_create(name.c_str(), "SimplyPhaserKernel")).first;
+    return found->second;
+  }
+  
   void initialize(int channelCount, double sampleRate) {
+    sampleRate_ = sampleRate;
+    lfo_.initialize(sampleRate, rate_);
+    for (auto& lfo : voiceLFOs_) lfo.initialize(sampleRate, rate_);
+    rightLFO_.initialize(sampleRate, rightRate_);
+    autoGain_.initialize(sampleRate);
+    engineSettings_ = wisdom_.settings(sampleRate);
     phaseShifters_.clear();
+    phaseShifters_.reserve(channelCount);
     for (auto index = 0; index < channelCount; ++index) {
-      phaseShifters_.emplace_back(PhaseShifter<FloatKind>::ideal, sampleRate, intensity_, 20);
+      phaseShifters_.emplace_back(PhaseShifter<FloatKind>::ideal, sampleRate, channelIntensity(index),
+                                  engineSettings_.samplesPerFilterUpdate, engineSettings_.stepsPerAnchor);
+      phaseShifters_.back().setExponentialSweep(logSweep_);
     }
+    // The multi-voice filters are always made here, even at one voice, so that changing the voice count never
+    // allocates and never changes the filters while the render thread may be using them.
+    voiceShifters_.clear();
+    voiceShifters_.reserve(channelCount);
+    for (auto index = 0; index < channelCount; ++index) {
+      voiceShifters_.emplace_back(PhaseShifter<FloatKind>::ideal, sampleRate, channelIntensity(index),
+                                  engineSettings_.samplesPerFilterUpdate, engineSettings_.stepsPerAnchor);
+      voiceShifters_.back().setExponentialSweep(logSweep_);
+    }
+    duplicates_.assign(channelCount, false);
+    mirroring_.assign(channelCount, false);
+    reset();
   }
   
   void doParameterEvent(const AUParameterEvent& event) { setParameterValue(event.parameterAddress, event.value); }
   
-  void doRendering(std::vector<AUValue const*> ins, std::vector<AUValue*> outs, AUAudioFrameCount frameCount) {
+  /**
+   Render a block of samples. The samples are either `AUValue` or `double` depending on the bus format. Processing is
+   always done in double precision, so float64 buffers are used as-is without any conversions.
+   */
+  template <typename Sample>
+  void doRendering(const std::vector<Sample const*>& ins, const std::vector<Sample*>& outs,
+                   AUAudioFrameCount frameCount) {
+    // Telemetry may be turned on or off during the render, so decide once whether to measure it.
+    bool measuring = telemetry_.isOpen();
+    std::chrono::steady_clock::time_point start;
+    AUValue inputPeak = 0.0;
+    if (measuring) {
+      start = std::chrono::steady_clock::now();
+      inputPeak = peakLevel(ins, frameCount);
+    }
+    
+    // Measure the input before rendering, since in-place rendering overwrites it.
+    FloatKind inputPower = autoGainEnabled_ ? AutoGain<FloatKind>::meanSquare(ins, frameCount) : 0.0;
+    
+    if (sync_ > 0 && musicalContext_.isValid()) {
+      lockLFOs(musicalContext_.transportMoving);
+    }
+    else if (synced_) {
+      releaseLFOs();
+    }
+    
+    if (voices_ > 1) {
+      renderVoices(ins, outs, frameCount);
+    }
+    else {
+      renderChannels(ins, outs, frameCount);
+    }
+    
+    // The right LFO only runs when odd channels render in unlinked mode. Keep it moving otherwise, so that it is where
+    // it should be when unlinked mode is turned on.
+    if (voices_ > 1 || !unlinked_ || ins.size() < 2) rightLFO_.advance(frameCount);
+    contextFrameOffset_ += frameCount;
+    
+    if (autoGainEnabled_) {
+      autoGain_.update(inputPower, AutoGain<FloatKind>::meanSquare(outs, frameCount), frameCount);
+    }
+    
+    if (measuring) {
+      auto outputPeak = peakLevel(outs, frameCount);
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+      telemetry_.recordRender(elapsed.count(), frameCount, inputPeak, outputPeak, nonFiniteResetCount(),
+                              droppedLogCount());
+    }
+  }
+  
+  template <typename Sample>
+  void renderChannels(const std::vector<Sample const*>& ins, const std::vector<Sample*>& outs,
+                      AUAudioFrameCount frameCount) {
+    
+    // Find the channels that will produce the same output as the first one. This must happen before any rendering
+    // since in-place rendering overwrites the inputs.
+    for (int channel = 1; channel < ins.size(); ++channel) {
+      duplicates_[channel] = !((odd90_ || unlinked_) && (channel & 1)) &&
+      memcmp(ins[channel], ins[0], frameCount * sizeof(Sample)) == 0;
+    }
+    
     auto lfoState = lfo_.saveState();
+    auto rightLFOState = rightLFO_.saveState();
+    auto gain = outputGain();
     for (int channel = 0; channel < ins.size(); ++channel) {
       auto& inputs = ins[channel];
       auto& outputs = outs[channel];
-      if (channel > 0) lfo_.restoreState(lfoState);
       auto& shifter{phaseShifters_[channel]};
+      
+      // In unlinked mode the odd channels have their own LFO and settings.
+      bool right = unlinked_ && (channel & 1);
+      auto& lfo = right ? rightLFO_ : lfo_;
+      auto depth = right ? rightDepth_ : depth_;
+      auto dryMix = (right ? rightDryMix_ : dryMix_) * gain;
+      auto wetMix = (right ? rightWetMix_ : wetMix_) * gain;
+      
+      // Channel is a copy of the first and its filter state is in sync with it -- just copy the results.
+      if (channel > 0 && duplicates_[channel] && mirroring_[channel]) {
+        memcpy(outputs, outs[0], frameCount * sizeof(Sample));
+        shifter.copyState(phaseShifters_[0]);
+        continue;
+      }
+      
+      // With no depth the filters are static. The LFO still runs so that the sweep resumes in phase.
+      if (channel > 0) lfo.restoreState(right ? rightLFOState : lfoState);
+      bool staticModulation = depth == 0.0;
+      bool quadPhase = odd90_ && (channel & 1);
+      for (int frame = 0; frame < frameCount; ++frame) {
+        auto inputSample = inputs[frame];
+        auto modulation = staticModulation ? 0.0 : (quadPhase ? lfo.quadPhaseValue() : lfo.value()) * depth;
+        lfo.increment();
+        auto outputSample = shifter.process(modulation, inputSample);
+        outputs[frame] = dryMix * inputSample + wetMix * outputSample;
+      }
+      
+      if (!shifter.isFinite()) recoverChannel(channel, outputs, frameCount);
+      
+      // Once the filter state of a duplicate channel is identical to that of the first one, the next blocks can be
+      // copied instead of rendered. The state is kept identical while copying, so rendering resumes seamlessly when the
+      // inputs diverge.
+      mirroring_[channel] = channel > 0 && duplicates_[channel] && shifter.sameState(phaseShifters_[0]);
+    }
+  }
+  
+  /**
+   Render all channels in multi-voice mode. All voices of a channel run together in one `MultiVoicePhaseShifter`, each
+   modulated by its own LFO. In unlinked mode the odd channels use their own depth, intensity and mix settings, but the
+   voice LFOs are shared by all channels.
+   */
+  template <typename Sample>
+  void renderVoices(const std::vector<Sample const*>& ins, const std::vector<Sample*>& outs,
+                    AUAudioFrameCount frameCount) {
+    std::array<LFO<FloatKind>::Phase, maxVoices> lfoStates;
+    for (int voice = 0; voice < voices_; ++voice) {
+      lfoStates[voice] = voiceLFO(voice).saveState();
+    }
+    auto gain = outputGain();
+    
+    for (int channel = 0; channel < ins.size(); ++channel) {
+      auto& inputs = ins[channel];
+      auto& outputs = outs[channel];
+      auto& shifter{voiceShifters_[channel]};
+      bool quadPhase = odd90_ && (channel & 1);
+      bool right = unlinked_ && (channel & 1);
+      auto depth = right ? rightDepth_ : depth_;
+      auto dryMix = (right ? rightDryMix_ : dryMix_) * gain;
+      auto wetMix = (right ? rightWetMix_ : wetMix_) * gain;
+      auto modulation = [this, quadPhase, depth](int voice) {
+        if (depth == 0.0) return FloatKind(0.0);
+        auto& lfo = voiceLFO(voice);
+        return (quadPhase ? lfo.quadPhaseValue() : lfo.value()) * depth;
+      };
+      
+      if (channel > 0) {
+        for (int voice = 0; voice < voices_; ++voice) {
+          voiceLFO(voice).restoreState(lfoStates[voice]);
+        }
+      }
+      
       for (int frame = 0; frame < frameCount; ++frame) {
         auto inputSample = inputs[frame];
-        auto modulation = odd90_ && (channel & 1) ? lfo_.quadPhaseValue() : lfo_.value();
-        lfo_.increment();
-        auto outputSample = shifter.process(modulation * depth_, inputSample);
-        outputs[frame] = dryMix_ * inputSample + wetMix_ * outputSample;
+        auto outputSample = shifter.process(modulation, inputSample);
+        for (int voice = 0; voice < voices_; ++voice) {
+          voiceLFO(voice).increment();
+        }
+        outputs[frame] = dryMix * inputSample + wetMix * outputSample;
       }
+      
+      if (!shifter.isFinite()) recoverChannel(channel, outputs, frameCount);
     }
+    
+    // The single-voice filters did not run, so they cannot be mirrored when switching back to them.
+    mirroring_.assign(mirroring_.size(), false);
   }
   
+  template <typename Sample>
+  static AUValue peakLevel(const std::vector<Sample*>& buffers, AUAudioFrameCount frameCount) {
+    AUValue peak = 0.0;
+    for (auto buffer : buffers) {
+      for (int frame = 0; frame < frameCount; ++frame) {
+        peak = std::max(peak, AUValue(std::abs(buffer[frame])));
+      }
+    }
+    return peak;
+  }
+  
+  /**
+   Recover from a NaN or Inf that has latched into a channel's filter state. Only the state of the affected channel is
+   reset, and the block it produced is replaced with silence.
+   */
+  template <typename Sample>
+  void recoverChannel(int channel, Sample* outputs, AUAudioFrameCount frameCount) {
+    phaseShifters_[channel].reset();
+    voiceShifters_[channel].reset();
+    std::fill(outputs, outputs + frameCount, 0.0);
+    nonFiniteResetCount_.fetch_add(1, std::memory_order_relaxed);
+    logger_.log(logNonFiniteReset, channel);
+  }
+  
+  /// @returns the level compensation to fold into the dry and wet mix factors
+  AUValue outputGain() const { return autoGainEnabled_ ? AUValue(autoGain_.gain()) : 1.0f; }
+  
+  AUValue channelIntensity(int channel) const { return unlinked_ && (channel & 1) ? rightIntensity_ : intensity_; }
+  
   void intensityChanged() {
+    for (int channel = 0; channel < phaseShifters_.size(); ++channel) {
+      phaseShifters_[channel].setIntensity(channelIntensity(channel));
+      voiceShifters_[channel].setIntensity(channelIntensity(channel));
+    }
+  }
+  
+  void logSweepChanged() {
     for (auto& filter : phaseShifters_) {
-      filter.setIntensity(intensity_);
+      filter.setExponentialSweep(logSweep_);
+    }
+    for (auto& filter : voiceShifters_) {
+      filter.setExponentialSweep(logSweep_);
+    }
+  }
+  
+  /**
+   Obtain the LFO for a voice. The first voice uses the main LFO so that switching voice counts does not disturb it.
+   */
+  LFO<FloatKind>& voiceLFO(int voice) { return voice == 0 ? lfo_ : voiceLFOs_[voice - 1]; }
+  
+  /**
+   Obtain the phase offset of a voice LFO from the main LFO, so that the active voices are spread evenly over a cycle.
+   Adding the offset to a phase wraps around on its own.
+   */
+  LFO<FloatKind>::Phase voicePhaseOffset(int voice) const { return LFO<FloatKind>::toPhase(double(voice) / voices_); }
+  
+  void voiceRatesChanged() {
+    for (int voice = 1; voice < maxVoices; ++voice) {
+      voiceLFO(voice).setFrequency(rate_ * (1.0 + voiceRateSpread * voice));
+    }
+  }
+  
+  /**
+   Set the rate of the LFOs from the host's tempo for the block about to be rendered, and their phase from the host's
+   beat position. Voices keep their phase offsets but all run at the synced rate.
+
+   @param lockPhase true to set the phase. While the host transport is stopped its beat position stands still, so the
+   LFOs keep running from where they are instead of being pulled back to the same phase every block.
+   */
+  void lockLFOs(bool lockPhase) {
+    auto beatsPerCycle = MusicalContext::syncBeatsPerCycle[sync_];
+    auto frequency = musicalContext_.frequency(beatsPerCycle);
+    for (int voice = 0; voice < maxVoices; ++voice) voiceLFO(voice).setFrequency(frequency);
+    rightLFO_.setFrequency(frequency);
+    synced_ = true;
+    if (!lockPhase) return;
+
+    auto beats = musicalContext_.beatsAt(contextFrameOffset_, sampleRate_);
+    auto phase = LFO<FloatKind>::toPhase(MusicalContext::phase(beats, beatsPerCycle));
+    for (int voice = 0; voice < maxVoices; ++voice) {
+      voiceLFO(voice).restoreState(voice < voices_ ? phase + voicePhaseOffset(voice) : phase);
+    }
+    rightLFO_.restoreState(phase);
+  }
+  
+  /**
+   Return to free-running LFOs, continuing from their current phases.
+   */
+  void releaseLFOs() {
+    lfo_.setFrequency(rate_);
+    rightLFO_.setFrequency(rightRate_);
+    voiceRatesChanged();
+    synced_ = false;
+  }
+  
+  /**
+   Spread the phases of the voice LFOs evenly over one LFO cycle, starting from the phase of the main LFO.
+   */
+  void voicesChanged() {
+    voiceRatesChanged();
+    auto phase = lfo_.saveState();
+    for (int voice = 1; voice < voices_; ++voice) {
+      voiceLFO(voice).restoreState(phase + voicePhaseOffset(voice));
+    }
+    for (auto& filter : voiceShifters_) {
+      filter.setVoiceCount(voices_);
     }
   }
   
   void doMIDIEvent(const AUMIDIEvent& midiEvent) {}
   
-  AUValue rate_;
-  AUValue depth_;
-  AUValue intensity_;
-  AUValue dryMix_;
-  AUValue wetMix_;
-  bool odd90_;
+  AUValue rate_ = 1.0;
+  AUValue depth_ = 0.5;
+  AUValue intensity_ = 0.75;
+  AUValue dryMix_ = 0.5;
+  AUValue wetMix_ = 0.5;
+  bool odd90_ = false;
+  bool logSweep_ = false;
+  bool unlinked_ = false;
+  AUValue rightRate_ = rate_;
+  AUValue rightDepth_ = depth_;
+  AUValue rightIntensity_ = intensity_;
+  AUValue rightDryMix_ = dryMix_;
+  AUValue rightWetMix_ = wetMix_;
+  bool autoGainEnabled_ = false;
+  AutoGain<FloatKind> autoGain_;
+  int voices_ = 1;
+  int sync_ = 0;
+  bool synced_ = false;
+  MusicalContext musicalContext_;
+  AUAudioFrameCount contextFrameOffset_ = 0;
+  double sampleRate_ = 0.0;
+  EngineWisdom wisdom_;
+  EngineWisdom::Settings engineSettings_ = EngineWisdom::defaults;
   LFO<FloatKind> lfo_;
+  std::array<LFO<FloatKind>, maxVoices - 1> voiceLFOs_;
+  LFO<FloatKind> rightLFO_;
   std::vector<PhaseShifter<FloatKind>> phaseShifters_;
+  std::vector<MultiVoicePhaseShifter<FloatKind, maxVoices>> voiceShifters_;
+  ClipBuffers<AUValue> floatClipBuffers_;
+  ClipBuffers<double> doubleClipBuffers_;
+  std::atomic<uint64_t> nonFiniteResetCount_{0};
+  std::vector<bool> duplicates_;
+  std::vector<bool> mirroring_;
+  Telemetry::Publisher telemetry_;
+  RealtimeLogger logger_;
+  bool parameterLogging_ = true;
 };
@@ -69,4 +69,114 @@
  */
 - (void)setBypass:(BOOL)state;
 
+/**
+ Set a parameter value directly by its address. Useful for offline rendering where there is no AUParameterTree.
+
+ @param value the new value to use
+ @param address the address of the parameter to change
+ */
+- (void)setValue:(AUValue)value forAddress:(AUParameterAddress)address;
+
+/**
+ Render a complete clip offline, starting from a reset kernel. The output includes the tail of the effect until it
+ decays below a threshold. Call after `startProcessing` with the format of the clip.
+
+ @param input the samples to render (non-interleaved float32 or float64)
+ @param output the buffer to hold the rendered samples, in the same format as `input`. Its frame capacity limits the
+ length of the tail.
+ @param tailThreshold the output level below which the tail is considered done
+ @returns the number of frames written to `output`, which is also its new frameLength. This is 0 if the sample format
+ or channel count of either buffer differs from the format given to `startProcessing`.
+ */
+- (AVAudioFrameCount)renderClip:(nonnull AVAudioPCMBuffer*)input
+                         output:(nonnull AVAudioPCMBuffer*)output
+                  tailThreshold:(AUValue)tailThreshold;
+
+/**
+ Render one piece of a longer stream offline. The kernel state carries over from one call to the next, so pieces
+ should be a multiple of 512 frames long, except for the last one. Call after `startProcessing` with the format of the
+ stream.
+
+ @param input the samples to render (non-interleaved float32 or float64)
+ @param output the buffer to hold the rendered samples, in the same format as `input`. Its frameLength is set to that
+ of the input.
+ @returns false if nothing was rendered because the sample format or channel count of either buffer differs from the
+ format given to `startProcessing`
+ */
+- (BOOL)renderStream:(nonnull AVAudioPCMBuffer*)input output:(nonnull AVAudioPCMBuffer*)output;
+
+/**
+ Render the tail of the effect after the end of a stream, from silent input. The frameLength of `output` is set to the
+ number of frames rendered.
+
+ @param output the buffer to hold the rendered samples. Its frame capacity limits the length of the tail rendered in
+ one call.
+ @param tailThreshold the output level below which the tail is considered done
+ @returns true if the tail is done, false if there is more to render. Also true, with nothing rendered, if the sample
+ format or channel count of `output` differs from the format given to `startProcessing`.
+ */
+- (BOOL)renderTail:(nonnull AVAudioPCMBuffer*)output tailThreshold:(AUValue)tailThreshold;
+
+/**
+ Begin publishing render statistics into a named shared-memory segment so that an external process can monitor them.
+ Call after `startProcessing`.
+
+ @param segmentName the name of the shared-memory segment (e.g. "/SimplyPhaser")
+ @returns true if publishing is active
+ */
+- (BOOL)enableTelemetry:(nonnull NSString*)segmentName;
+
+/**
+ Stop publishing render statistics.
+ */
+- (void)disableTelemetry;
+
+/**
+ Use tuned engine settings from a wisdom file. The settings take effect at the next `startProcessing`. When the file
+ is missing, was made on another machine, or is not valid, the kernel keeps its default settings.
+
+ @param path the location of the wisdom file
+ @returns true if the file was loaded
+ */
+- (BOOL)loadWisdom:(nonnull NSString*)path;
+
+/**
+ Benchmark engine settings on this machine and save the fastest ones that are accurate enough (see `EngineWisdom`) to a
+ wisdom file. Entries in an existing file for other sample rates are kept. Takes a second or so per sample rate, so do
+ not call from the main thread.
+
+ @param path the location of the wisdom file
+ @param sampleRates the sample rates to tune for
+ @returns true if the file was saved
+ */
++ (BOOL)tuneWisdom:(nonnull NSString*)path sampleRates:(nonnull NSArray<NSNumber*>*)sampleRates;
+
+/**
+ The host block that provides the tempo and beat position for tempo-synced LFO rates. Fetched at the start of every
+ render call.
+ */
+@property (nonatomic, copy, nullable) AUHostMusicalContextBlock musicalContextBlock;
+
+/**
+ The host block that reports whether the transport is moving. Tempo-synced LFOs only follow the beat position while it
+ is. Fetched at the start of every render call.
+ */
+@property (nonatomic, copy, nullable) AUHostTransportStateBlock transportStateBlock;
+
+/**
+ True if parameter changes are logged (the default). Turn off when rendering offline, where parameters are set for
+ every clip, so that the log is not flooded.
+ */
+@property (nonatomic) BOOL parameterLogging;
+
+/**
+ The number of times the kernel had to reset the filter state of a channel because it held NaN or Inf values.
+ */
+@property (nonatomic, readonly) uint64_t nonFiniteResetCount;
+
+/**
+ The number of log statements from the render thread that were dropped because the realtime logger was full.
+ */
+@property (nonatomic, readonly) uint64_t droppedLogCount;
+
 @end
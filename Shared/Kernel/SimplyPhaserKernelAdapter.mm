@@ -5,8 +5,43 @@
 #import "SimplyPhaserKernel.h"
 #import "SimplyPhaserKernelAdapter.h"
 
+/**
+ Obtain the sample buffers of the channels of a non-interleaved buffer. Unlike `floatChannelData`, this works for
+ float64 buffers as well.
+
+ @param buffer the buffer to use
+ @param channelCount the number of channels to return
+ @returns the buffer pointers cast to the type `Pointer`
+ */
+template <typename Pointer>
+static std::vector<Pointer> channels(AVAudioPCMBuffer* buffer, AVAudioChannelCount channelCount) {
+  std::vector<Pointer> pointers;
+  auto bufferList = buffer.mutableAudioBufferList;
+  for (AVAudioChannelCount channel = 0; channel < channelCount; ++channel) {
+    pointers.push_back(static_cast<Pointer>(bufferList->mBuffers[channel].mData));
+  }
+  return pointers;
+}
+
+/**
+ Determine if a buffer can be rendered by a kernel that was started with the given format. The buffer must hold the
+ same kind of float samples for the same number of channels, each in its own buffer.
+
+ @param buffer the buffer to check
+ @param format the format given to `startProcessing` or nil if the kernel is not started
+ @returns true if the buffer matches the format
+ */
+static bool matches(AVAudioPCMBuffer* buffer, AVAudioFormat* format) {
+  if (format == nil) return false;
+  auto commonFormat = buffer.format.commonFormat;
+  return (commonFormat == AVAudioPCMFormatFloat32 || commonFormat == AVAudioPCMFormatFloat64) &&
+  commonFormat == format.commonFormat && buffer.format.channelCount == format.channelCount &&
+  buffer.audioBufferList->mNumberBuffers == format.channelCount;
+}
+
 @implementation SimplyPhaserKernelAdapter {
   SimplyPhaserKernel* kernel_;
+  AVAudioFormat* format_;
 }
 
 - (instancetype)init:(NSString*)appExtensionName {
@@ -18,10 +53,12 @@
 
 - (void)startProcessing:(AVAudioFormat*)inputFormat maxFramesToRender:(AUAudioFrameCount)maxFramesToRender {
   kernel_->startProcessing(inputFormat, maxFramesToRender);
+  format_ = inputFormat;
 }
 
 - (void)stopProcessing {
   kernel_->stopProcessing();
+  format_ = nil;
 }
 
 - (void)set:(AUParameter *)parameter value:(AUValue)value { kernel_->setParameterValue(parameter.address, value); }
@@ -34,6 +71,17 @@
                        events:(AURenderEvent*)realtimeEventListHead
                pullInputBlock:(AURenderPullInputBlock)pullInputBlock
 {
+  MusicalContext context;
+  if (_musicalContextBlock != nullptr &&
+      !_musicalContextBlock(&context.tempo, nullptr, nullptr, &context.beatPosition, nullptr, nullptr)) {
+    context = MusicalContext();
+  }
+  AUHostTransportStateFlags transportState;
+  if (_transportStateBlock != nullptr && _transportStateBlock(&transportState, nullptr, nullptr, nullptr)) {
+    context.transportMoving = (transportState & AUHostTransportStateMoving) != 0;
+  }
+  kernel_->setMusicalContext(context);
+
   auto inputBus = 0;
   return kernel_->processAndRender(timestamp, frameCount, inputBus, output, realtimeEventListHead, pullInputBlock);
 }
@@ -42,4 +90,99 @@
   kernel_->setBypass(state);
 }
 
+- (void)setValue:(AUValue)value forAddress:(AUParameterAddress)address {
+  kernel_->setParameterValue(address, value);
+}
+
+- (AVAudioFrameCount)renderClip:(AVAudioPCMBuffer*)input
+                         output:(AVAudioPCMBuffer*)output
+                  tailThreshold:(AUValue)tailThreshold
+{
+  if (!matches(input, format_) || !matches(output, format_)) {
+    output.frameLength = 0;
+    return 0;
+  }
+  auto channelCount = format_.channelCount;
+  auto frameCount = std::min(input.frameLength, output.frameCapacity);
+  auto maxTailFrames = output.frameCapacity - frameCount;
+  auto rendered = format_.commonFormat == AVAudioPCMFormatFloat64
+  ? kernel_->renderClip(channels<double const*>(input, channelCount), channels<double*>(output, channelCount),
+                        frameCount, maxTailFrames, tailThreshold)
+  : kernel_->renderClip(channels<AUValue const*>(input, channelCount), channels<AUValue*>(output, channelCount),
+                        frameCount, maxTailFrames, tailThreshold);
+  output.frameLength = AVAudioFrameCount(rendered);
+  return output.frameLength;
+}
+
+- (BOOL)renderStream:(AVAudioPCMBuffer*)input output:(AVAudioPCMBuffer*)output {
+  if (!matches(input, format_) || !matches(output, format_)) {
+    output.frameLength = 0;
+    return NO;
+  }
+  auto channelCount = format_.channelCount;
+  auto frameCount = std::min(input.frameLength, output.frameCapacity);
+  if (format_.commonFormat == AVAudioPCMFormatFloat64) {
+    kernel_->renderStream(channels<double const*>(input, channelCount), channels<double*>(output, channelCount),
+                          frameCount);
+  }
+  else {
+    kernel_->renderStream(channels<AUValue const*>(input, channelCount), channels<AUValue*>(output, channelCount),
+                          frameCount);
+  }
+  output.frameLength = frameCount;
+  return YES;
+}
+
+- (BOOL)renderTail:(AVAudioPCMBuffer*)output tailThreshold:(AUValue)tailThreshold {
+  if (!matches(output, format_)) {
+    output.frameLength = 0;
+    return YES;
+  }
+  auto channelCount = format_.channelCount;
+  bool done;
+  auto rendered = format_.commonFormat == AVAudioPCMFormatFloat64
+  ? kernel_->renderTail(channels<double*>(output, channelCount), output.frameCapacity, tailThreshold, done)
+  : kernel_->renderTail(channels<AUValue*>(output, channelCount), output.frameCapacity, tailThreshold, done);
+  output.frameLength = AVAudioFrameCount(rendered);
+  return done;
+}
+
+- (BOOL)parameterLogging {
+  return kernel_->parameterLogging();
+}
+
+- (void)setParameterLogging:(BOOL)parameterLogging {
+  kernel_->setParameterLogging(parameterLogging);
+}
+
+- (BOOL)enableTelemetry:(NSString*)segmentName {
+  return kernel_->enableTelemetry(std::string(segmentName.UTF8String));
+}
+
+- (void)disableTelemetry {
+  kernel_->disableTelemetry();
+}
+
+- (BOOL)loadWisdom:(NSString*)path {
+  return kernel_->loadWisdom(std::string(path.UTF8String));
+}
+
++ (BOOL)tuneWisdom:(NSString*)path sampleRates:(NSArray<NSNumber*>*)sampleRates {
+  std::string location(path.UTF8String);
+  EngineWisdom wisdom;
+  wisdom.load(location);
+  for (NSNumber* sampleRate in sampleRates) {
+    wisdom.set(sampleRate.doubleValue, EngineWisdom::tune(sampleRate.doubleValue));
+  }
+  return wisdom.save(location);
+}
+
+- (uint64_t)nonFiniteResetCount {
+  return kernel_->nonFiniteResetCount();
+}
+
+- (uint64_t)droppedLogCount {
+  return kernel_->droppedLogCount();
+}
+
 @end
@@ -0,0 +1,113 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+/**
+ Measures how different two signals sound by comparing their short-time magnitude spectra. The reference signal is
+ analyzed once when the instance is created, so each comparison only analyzes the candidate signal. The loss is the mean
+ absolute difference of log-compressed magnitudes over all frames and bins, which weights quiet spectral detail such
+ as phaser notches much more than a sample-domain error would.
+
+ An instance holds the work buffers for the analysis, so use one instance per thread.
+ */
+template <typename T>
+class SpectralLoss {
+public:
+
+  /**
+   Construct new instance.
+
+   @param reference the samples of the reference signal
+   @param frameCount the number of samples in the reference signal
+   @param fftSize the number of samples in an analysis frame (must be a power of 2)
+   */
+  SpectralLoss(T const* reference, size_t frameCount, size_t fftSize = 1024)
+  : fftSize_{fftSize}, hopSize_{fftSize / 2}, window_(fftSize), work_(fftSize)
+  {
+    assert(fftSize >= 2 && (fftSize & (fftSize - 1)) == 0);
+    for (size_t index = 0; index < fftSize; ++index) {
+      window_[index] = 0.5 - 0.5 * std::cos(2.0 * M_PI * index / fftSize);
+    }
+    reference_ = analyze(reference, frameCount);
+  }
+
+  /**
+   Obtain the loss of a candidate signal relative to the reference signal.
+
+   @param candidate the samples of the candidate signal (must be as long as the reference signal)
+   @returns the loss value (0.0 for identical signals)
+   */
+  double operator()(T const* candidate) {
+    auto frames = frameCount();
+    auto bins = binCount();
+    double sum = 0.0;
+    for (size_t frame = 0; frame < frames; ++frame) {
+      transform(candidate + frame * hopSize_);
+      auto const* reference = reference_.data() + frame * bins;
+      for (size_t bin = 0; bin < bins; ++bin) {
+        sum += std::abs(compress(std::abs(work_[bin])) - reference[bin]);
+      }
+    }
+    return frames == 0 ? 0.0 : sum / (frames * bins);
+  }
+
+  /// @returns number of analysis frames
+  size_t frameCount() const { return reference_.size() / binCount(); }
+
+  /// @returns number of magnitude bins in each analysis frame
+  size_t binCount() const { return fftSize_ / 2 + 1; }
+
+private:
+
+  static double compress(double magnitude) { return std::log1p(magnitude); }
+
+  std::vector<double> analyze(T const* samples, size_t frameCount) {
+    std::vector<double> magnitudes;
+    if (frameCount < fftSize_) return magnitudes;
+    auto frames = (frameCount - fftSize_) / hopSize_ + 1;
+    magnitudes.reserve(frames * binCount());
+    for (size_t frame = 0; frame < frames; ++frame) {
+      transform(samples + frame * hopSize_);
+      for (size_t bin = 0; bin < binCount(); ++bin) {
+        magnitudes.push_back(compress(std::abs(work_[bin])));
+      }
+    }
+    return magnitudes;
+  }
+
+  /**
+   Window one frame of samples into the work buffer and perform an in-place radix-2 FFT on it.
+   */
+  void transform(T const* samples) {
+    auto size = fftSize_;
+    for (size_t index = 0, reversed = 0; index < size; ++index) {
+      work_[reversed] = std::complex<double>(samples[index] * window_[index], 0.0);
+      for (size_t bit = size >> 1; (reversed ^= bit) < bit; bit >>= 1) {}
+    }
+    for (size_t length = 2; length <= size; length <<= 1) {
+      auto step = std::polar(1.0, -2.0 * M_PI / length);
+      for (size_t start = 0; start < size; start += length) {
+        std::complex<double> twiddle{1.0, 0.0};
+        for (size_t index = 0; index < length / 2; ++index) {
+          auto even = work_[start + index];
+          auto odd = work_[start + index + length / 2] * twiddle;
+          work_[start + index] = even + odd;
+          work_[start + index + length / 2] = even - odd;
+          twiddle *= step;
+        }
+      }
+    }
+  }
+
+  size_t fftSize_;
+  size_t hopSize_;
+  std::vector<double> window_;
+  std::vector<std::complex<double>> work_;
+  std::vector<double> reference_;
+};
@@ -0,0 +1,189 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#pragma once
+
+#include <cmath>
+
+namespace DSP {
+
+/**
+ Tangent of a small angle from its Taylor series. For |angle| <= 0.05 the error of the 11th-order series is below 1e-19.
+
+ @param angle the angle in radians
+ @returns approximate tan(angle)
+ */
+template <typename T> T smallAngleTangent(T angle) {
+  T square = angle * angle;
+  return angle * (T(1.0) + square * (T(1.0 / 3.0) + square * (T(2.0 / 15.0) + square * (T(17.0 / 315.0) +
+                                                                                       square * T(62.0 / 2835.0)))));
+}
+
+/**
+ Sine and cosine of a small angle from their Taylor series. For |angle| <= 0.05 the errors are below 1e-17.
+
+ @param angle the angle in radians
+ @param sine receives approximate sin(angle)
+ @param cosine receives approximate cos(angle)
+ */
+template <typename T> void smallAngleSineCosine(T angle, T& sine, T& cosine) {
+  T square = angle * angle;
+  sine = angle * (T(1.0) - square * (T(1.0 / 6.0) - square * (T(1.0 / 120.0) - square * T(1.0 / 5040.0))));
+  cosine = T(1.0) - square * (T(0.5) - square * (T(1.0 / 24.0) - square * (T(1.0 / 720.0) -
+                                                                           square * T(1.0 / 40320.0))));
+}
+
+/**
+ Tracks tan(angle) for an angle that moves in small steps, such as the frequency of an all-pass filter that is swept by
+ an LFO. Instead of calling `std::tan` on every update, the value is advanced from the previous one with the identity
+
+   tan(a + d) = (tan(a) + tan(d)) / (1 - tan(a) tan(d))
+
+ where tan(d) of the small step comes from a short polynomial. Rounding errors add up over many steps, so the value is
+ recalculated with `std::tan` every `stepsPerAnchor` steps and also whenever a step is too large for the polynomial.
+ */
+template <typename T>
+class TangentRecurrence {
+public:
+
+  /// Largest step in radians that is taken incrementally
+  static constexpr T maxStep = 0.05;
+
+  /**
+   Construct new instance.
+
+   @param stepsPerAnchor number of incremental steps before the value is recalculated exactly
+   */
+  explicit TangentRecurrence(int stepsPerAnchor = 64) : stepsPerAnchor_{stepsPerAnchor} {}
+
+  /**
+   Obtain the tangent of an angle, advancing from the previous angle if it is close enough.
+
+   @param angle the angle in radians (must be in (-pi/2, pi/2))
+   @returns tan(angle)
+   */
+  T operator()(T angle) {
+    T step = angle - angle_;
+    if (step == 0.0) return tangent_;
+    if (++steps_ >= stepsPerAnchor_ || std::abs(step) > maxStep) return anchor(angle);
+    T stepTangent = smallAngleTangent(step);
+    angle_ = angle;
+    tangent_ = (tangent_ + stepTangent) / (T(1.0) - tangent_ * stepTangent);
+    return tangent_;
+  }
+
+  /**
+   Calculate the tangent exactly and start counting steps again.
+
+   @param angle the angle in radians
+   @returns tan(angle)
+   */
+  T anchor(T angle) {
+    steps_ = 0;
+    angle_ = angle;
+    tangent_ = std::tan(angle);
+    return tangent_;
+  }
+
+  /**
+   Forget the previous angle, so that the values that follow are the same as those of a new instance.
+   */
+  void reset() {
+    steps_ = 0;
+    angle_ = 0.0;
+    tangent_ = 0.0;
+  }
+
+  /**
+   Determine if another instance is in the same state, so that both return the same values from here on.
+
+   @param other the instance to compare with
+   @returns true if the states are identical
+   */
+  bool operator==(const TangentRecurrence<T>& other) const {
+    return stepsPerAnchor_ == other.stepsPerAnchor_ && steps_ == other.steps_ && angle_ == other.angle_ &&
+    tangent_ == other.tangent_;
+  }
+
+private:
+  int stepsPerAnchor_;
+  int steps_{0};
+  T angle_{0.0};
+  T tangent_{0.0};
+};
+
+/**
+ Tracks sin(angle) and cos(angle) for an angle that moves in small steps. Each update rotates the previous values by
+ the step with the angle-addition identities, using polynomials for the sine and cosine of the small step. As with
+ `TangentRecurrence`, the values are recalculated exactly every `stepsPerAnchor` steps and for large steps.
+ */
+template <typename T>
+class SineCosineRecurrence {
+public:
+
+  /// Largest step in radians that is taken incrementally
+  static constexpr T maxStep = 0.05;
+
+  /**
+   Construct new instance.
+
+   @param stepsPerAnchor number of incremental steps before the values are recalculated exactly
+   */
+  explicit SineCosineRecurrence(int stepsPerAnchor = 64) : stepsPerAnchor_{stepsPerAnchor} {}
+
+  /**
+   Move to a new angle, advancing from the previous angle if it is close enough.
+
+   @param angle the angle in radians
+   */
+  void operator()(T angle) {
+    T step = angle - angle_;
+    if (step == 0.0) return;
+    if (++steps_ >= stepsPerAnchor_ || std::abs(step) > maxStep) {
+      anchor(angle);
+      return;
+    }
+    T stepSine, stepCosine;
+    smallAngleSineCosine(step, stepSine, stepCosine);
+    angle_ = angle;
+    T sine = sine_ * stepCosine + cosine_ * stepSine;
+    cosine_ = cosine_ * stepCosine - sine_ * stepSine;
+    sine_ = sine;
+  }
+
+  /**
+   Calculate the values exactly and start counting steps again.
+
+   @param angle the angle in radians
+   */
+  void anchor(T angle) {
+    steps_ = 0;
+    angle_ = angle;
+    sine_ = std::sin(angle);
+    cosine_ = std::cos(angle);
+  }
+
+  /**
+   Return to the state of a new instance (see `TangentRecurrence::reset`).
+   */
+  void reset() {
+    steps_ = 0;
+    angle_ = 0.0;
+    sine_ = 0.0;
+    cosine_ = 1.0;
+  }
+
+  /// @returns sin of the last angle
+  T sine() const { return sine_; }
+
+  /// @returns cos of the last angle
+  T cosine() const { return cosine_; }
+
+private:
+  int stepsPerAnchor_;
+  int steps_{0};
+  T angle_{0.0};
+  T sine_{0.0};
+  T cosine_{1.0};
+};
+
+} // namespace DSP
@@ -0,0 +1,163 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+import AVFoundation
+import CryptoKit
+import os
+
+/**
+ Renders audition previews of presets over reference clips so that browsing presets does not require real-time
+ playback. All of the previews are rendered offline in parallel, each with its own kernel, and are kept in a disk
+ cache. The cache is content-addressed: the name of a preview file is a hash of the kernel version, the samples of the
+ clip and the parameter values of the preset. A preview is therefore only rendered again when one of those changes, and
+ stale entries are simply never looked up again.
+ */
+public final class PresetPreviewService {
+  private static let log = Logging.logger("PresetPreviewService")
+  private var log: OSLog { Self.log }
+
+  /// The output level below which the tail of a preview ends
+  public static let tailThreshold: AUValue = 1.0e-4
+  /// The max length of the tail of a preview in seconds
+  public static let maxTailDuration: Double = 2.0
+
+  /// Location of the reference clip that is bundled with the host apps
+  public static var defaultClip: URL? {
+    Bundle.main.url(forResource: "074_acoustic-guitar-strummy2", withExtension: "wav")
+  }
+
+  private let cacheDirectory: URL
+  private let kernelVersion: String
+  private let renderQueue: DispatchQueue
+  private let clipHashes = NSCache<NSURL, NSString>()
+
+  /**
+   Create a new service.
+
+   - parameter cacheDirectory: the directory that holds the rendered previews
+   - parameter kernelVersion: identifies the DSP code that renders the previews. Previews made by another version are
+   not used.
+   */
+  public init(cacheDirectory: URL, kernelVersion: String = PresetPreviewService.bundleKernelVersion) {
+    self.cacheDirectory = cacheDirectory
+    self.kernelVersion = kernelVersion
+    self.renderQueue = DispatchQueue(label: "PresetPreviewService.render", qos: .utility)
+  }
+
+  /// The version of the framework that holds the kernel
+  public static var bundleKernelVersion: String {
+    let bundle = Bundle(for: PresetPreviewService.self)
+    return "\(bundle.releaseVersionNumber).\(bundle.buildVersionNumber)"
+  }
+
+  /**
+   Obtain the location of a preview if it has already been rendered.
+
+   - parameter preset: the preset to audition
+   - parameter clip: the location of the reference clip
+   - returns: the location of the preview file or nil if it has not been rendered
+   */
+  public func cachedPreview(for preset: FilterPreset, clip: URL) -> URL? {
+    guard let url = previewLocation(for: preset, clip: clip) else { return nil }
+    return FileManager.default.fileExists(atPath: url.path) ? url : nil
+  }
+
+  /**
+   Render the previews of a collection of presets over a collection of clips. Previews that are already in the cache
+   are not rendered again. Rendering happens in the background, spread across all cores.
+
+   - parameter presets: the presets to audition
+   - parameter clips: the locations of the reference clips
+   - parameter completion: closure called on the main queue with the preview locations, indexed by preset and then by
+   clip. An entry is nil if its preview could not be rendered.
+   */
+  public func renderPreviews(presets: [FilterPreset], clips: [URL], completion: @escaping ([[URL?]]) -> Void) {
+    renderQueue.async {
+      let clipCount = clips.count
+      let buffers = clips.map { try? Self.load(clip: $0) }
+      let results = UnsafeMutableBufferPointer<URL?>.allocate(capacity: presets.count * clipCount)
+      results.initialize(repeating: nil)
+      defer { results.deallocate() }
+
+      DispatchQueue.concurrentPerform(iterations: presets.count * clipCount) { index in
+        let preset = presets[index / clipCount]
+        let clipIndex = index % clipCount
+        results[index] = self.preview(for: preset, clip: clips[clipIndex], buffer: buffers[clipIndex])
+      }
+
+      let previews = (0..<presets.count).map { Array(results[($0 * clipCount)..<(($0 + 1) * clipCount)]) }
+      DispatchQueue.main.async { completion(previews) }
+    }
+  }
+}
+
+private extension PresetPreviewService {
+
+  static func load(clip: URL) throws -> AVAudioPCMBuffer? {
+    let file = try AVAudioFile(forReading: clip)
+    guard let buffer = AVAudioPCMBuffer(pcmFormat: file.processingFormat,
+                                        frameCapacity: AVAudioFrameCount(file.length)) else { return nil }
+    try file.read(into: buffer)
+    return buffer
+  }
+
+  func previewLocation(for preset: FilterPreset, clip: URL) -> URL? {
+    guard let clipHash = hash(of: clip) else { return nil }
+    var key = "kernel=\(kernelVersion);clip=\(clipHash)"
+    for (address, value) in preset.parameterValues {
+      key += ";\(address.rawValue)=\(value)"
+    }
+    let digest = SHA256.hash(data: Data(key.utf8))
+    let name = digest.map { String(format: "%02x", $0) }.joined()
+    return cacheDirectory.appendingPathComponent(name).appendingPathExtension("caf")
+  }
+
+  func hash(of clip: URL) -> String? {
+    if let cached = clipHashes.object(forKey: clip as NSURL) { return cached as String }
+    guard let data = try? Data(contentsOf: clip, options: .mappedIfSafe) else { return nil }
+    let value = SHA256.hash(data: data).map { String(format: "%02x", $0) }.joined()
+    clipHashes.setObject(value as NSString, forKey: clip as NSURL)
+    return value
+  }
+
+  func preview(for preset: FilterPreset, clip: URL, buffer: AVAudioPCMBuffer?) -> URL? {
+    guard let url = previewLocation(for: preset, clip: clip) else { return nil }
+    if FileManager.default.fileExists(atPath: url.path) { return url }
+    guard let input = buffer else { return nil }
+
+    let format = input.format
+    let tailFrames = AVAudioFrameCount(Self.maxTailDuration * format.sampleRate)
+    guard let output = AVAudioPCMBuffer(pcmFormat: format, frameCapacity: input.frameLength + tailFrames) else {
+      return nil
+    }
+
+    let kernel = SimplyPhaserKernelAdapter("PresetPreview")
+    kernel.parameterLogging = false
+    kernel.startProcessing(format, maxFramesToRender: 512)
+    for (address, value) in preset.parameterValues {
+      kernel.setValue(value, forAddress: address.rawValue)
+    }
+    kernel.renderClip(input, output: output, tailThreshold: Self.tailThreshold)
+    kernel.stopProcessing()
+
+    // Write to a temporary file first, then rename it to its final name. The rename atomically replaces any file
+    // that another render of the same preview put there in the meantime, so a partial preview never appears under
+    // the final name and nothing is left behind under the temporary one.
+    let temporary = cacheDirectory.appendingPathComponent(UUID().uuidString).appendingPathExtension("caf")
+    do {
+      try FileManager.default.createDirectory(at: cacheDirectory, withIntermediateDirectories: true)
+      do {
+        let file = try AVAudioFile(forWriting: temporary, settings: format.settings, commonFormat: format.commonFormat,
+                                   interleaved: format.isInterleaved)
+        try file.write(from: output)
+      }
+      if rename(temporary.path, url.path) != 0 {
+        throw POSIXError(POSIXErrorCode(rawValue: errno) ?? .EIO)
+      }
+      return url
+    } catch {
+      try? FileManager.default.removeItem(at: temporary)
+      os_log(.error, log: log, "failed to write preview - %{public}s", error.localizedDescription)
+      return nil
+    }
+  }
+}
@@ -0,0 +1,211 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#pragma once
+
+#import <algorithm>
+#import <array>
+#import <atomic>
+#import <chrono>
+#import <condition_variable>
+#import <cstdint>
+#import <cstdio>
+#import <functional>
+#import <mutex>
+#import <thread>
+#import <vector>
+
+#import "NonCopyable.hpp"
+
+/**
+ Logger that is safe to use from the audio render thread. A log statement is just a fixed-size binary record -- the
+ index of a format string plus up to four numeric arguments -- that is pushed into a lock-free ring owned by the
+ logger. Pushing never allocates, locks, or blocks: if the ring is full the record is dropped and counted.
+
+ A single background thread shared by all loggers periodically drains the rings, formats the records with `snprintf`,
+ and hands the resulting text to each logger's sink (`os_log` on Apple platforms, but any function will do).
+
+ All arguments are stored as `double` values, so format strings must only use floating-point conversions such as
+ `%f`, `%g`, or `%.0f`.
+ */
+class RealtimeLogger : NonCopyable {
+public:
+  /// Max number of arguments in one record
+  static constexpr size_t maxArgs = 4;
+  /// Number of records the ring can hold. Must be a power of 2.
+  static constexpr size_t capacity = 256;
+
+  /// Function that receives formatted log messages in the background thread.
+  using Sink = std::function<void(const char* message)>;
+
+  /**
+   Construct new logger.
+
+   @param formats the format strings that log records refer to by index
+   @param sink the function to call with formatted messages
+   */
+  RealtimeLogger(std::vector<const char*> formats, Sink sink) : formats_{std::move(formats)}, sink_{std::move(sink)}
+  {
+    for (size_t index = 0; index < capacity; ++index) {
+      slots_[index].sequence.store(index, std::memory_order_relaxed);
+    }
+    Flusher::shared().add(this);
+  }
+
+  ~RealtimeLogger() {
+    Flusher::shared().remove(this);
+    flush();
+  }
+
+  /**
+   Record a log statement. Safe to call from any thread, including the render thread.
+
+   @param formatId the index of the format string to use
+   @param args the numeric arguments for the format string
+   @returns true if recorded, false if the ring was full and the record was dropped
+   */
+  template <typename... Args>
+  bool log(uint32_t formatId, Args... args) {
+    static_assert(sizeof...(Args) <= maxArgs, "too many log arguments");
+    Record record{formatId, uint32_t(sizeof...(Args)), {double(args)...}};
+    return push(record);
+  }
+
+  /**
+   Obtain the number of records that were dropped because the ring was full.
+
+   @returns drop count
+   */
+  uint64_t droppedCount() const { return droppedCount_.load(std::memory_order_relaxed); }
+
+  /**
+   Format and emit all pending records. Normally called from the shared background thread, but it is safe to call it
+   from another non-realtime thread as well.
+
+   @returns number of records emitted
+   */
+  size_t flush() {
+    std::lock_guard<std::mutex> guard(flushMutex_);
+    size_t count = 0;
+    Record record;
+    while (pop(record)) {
+      emit(record);
+      ++count;
+    }
+    return count;
+  }
+
+private:
+
+  struct Record {
+    uint32_t formatId;
+    uint32_t argCount;
+    double args[maxArgs];
+  };
+
+  struct Slot {
+    std::atomic<size_t> sequence;
+    Record record;
+  };
+
+  /**
+   Single background thread that drains all of the active loggers.
+   */
+  class Flusher {
+  public:
+    static Flusher& shared() {
+      static Flusher flusher;
+      return flusher;
+    }
+
+    void add(RealtimeLogger* logger) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      loggers_.push_back(logger);
+      if (!thread_.joinable()) thread_ = std::thread([this] { run(); });
+    }
+
+    void remove(RealtimeLogger* logger) {
+      std::lock_guard<std::mutex> guard(mutex_);
+      loggers_.erase(std::remove(loggers_.begin(), loggers_.end(), logger), loggers_.end());
+    }
+
+    ~Flusher() {
+      {
+        std::lock_guard<std::mutex> guard(mutex_);
+        stop_ = true;
+      }
+      wakeup_.notify_one();
+      if (thread_.joinable()) thread_.join();
+    }
+
+  private:
+    void run() {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (!stop_) {
+        for (auto logger : loggers_) logger->flush();
+        wakeup_.wait_for(lock, std::chrono::milliseconds(50));
+      }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::vector<RealtimeLogger*> loggers_;
+    std::thread thread_;
+    bool stop_ = false;
+  };
+
+  bool push(const Record& record) {
+    size_t position = enqueuePosition_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+      slot = &slots_[position & (capacity - 1)];
+      auto sequence = slot->sequence.load(std::memory_order_acquire);
+      auto difference = intptr_t(sequence) - intptr_t(position);
+      if (difference == 0) {
+        if (enqueuePosition_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+      }
+      else if (difference < 0) {
+        droppedCount_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      else {
+        position = enqueuePosition_.load(std::memory_order_relaxed);
+      }
+    }
+
+    slot->record = record;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(Record& record) {
+    auto& slot = slots_[dequeuePosition_ & (capacity - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition_ + 1) return false;
+    record = slot.record;
+    slot.sequence.store(dequeuePosition_ + capacity, std::memory_order_release);
+    ++dequeuePosition_;
+    return true;
+  }
+
+  void emit(const Record& record) {
+    if (record.formatId >= formats_.size()) return;
+    auto format = formats_[record.formatId];
+    auto const& args = record.args;
+    char buffer[256];
+    switch (record.argCount) {
+      case 0: snprintf(buffer, sizeof(buffer), "%s", format); break;
+      case 1: snprintf(buffer, sizeof(buffer), format, args[0]); break;
+      case 2: snprintf(buffer, sizeof(buffer), format, args[0], args[1]); break;
+      case 3: snprintf(buffer, sizeof(buffer), format, args[0], args[1], args[2]); break;
+      default: snprintf(buffer, sizeof(buffer), format, args[0], args[1], args[2], args[3]); break;
+    }
+    sink_(buffer);
+  }
+
+  std::vector<const char*> formats_;
+  Sink sink_;
+  std::array<Slot, capacity> slots_;
+  alignas(64) std::atomic<size_t> enqueuePosition_{0};
+  alignas(64) size_t dequeuePosition_{0};
+  std::atomic<uint64_t> droppedCount_{0};
+  std::mutex flushMutex_;
+};
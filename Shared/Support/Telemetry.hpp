@@ -0,0 +1,323 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#pragma once
+
+#import <atomic>
+#import <cerrno>
+#import <cstdint>
+#import <cstring>
+#import <string>
+#import <thread>
+#import <utility>
+#import <vector>
+
+#import <fcntl.h>
+#import <signal.h>
+#import <sys/mman.h>
+#import <sys/stat.h>
+#import <unistd.h>
+
+#import "NonCopyable.hpp"
+
+/**
+ Optional export of render statistics into a named POSIX shared-memory segment so that an external monitoring process
+ can observe every instance on a machine without linking into the host. The segment holds a fixed array of slots, one
+ per publishing instance. Each slot is protected by a sequence lock: the render thread bumps the sequence to an odd
+ value, writes the data, and bumps it again to an even value. Readers retry if the sequence changed or was odd while
+ they copied. Publishing is just plain memory writes -- there are no system calls on the render thread.
+ */
+namespace Telemetry {
+
+/// Value in the segment header that identifies a valid segment
+constexpr uint32_t segmentMagic = 0x5350544d; // 'SPTM'
+/// Value in the segment header while the process that created the segment fills in the rest of the header
+constexpr uint32_t segmentInitializing = 0x53505449; // 'SPTI'
+/// Version of the segment layout
+constexpr uint32_t segmentVersion = 1;
+/// Max number of instances that can publish into one segment
+constexpr uint32_t maxSlots = 256;
+/// Number of buckets in the render time histogram. Bucket N counts renders that took [2^N, 2^(N+1)) microseconds, with
+/// the first and last buckets also holding everything below and above.
+constexpr uint32_t histogramBuckets = 16;
+
+/// The statistics published by one instance.
+struct Data {
+  uint32_t channelCount;
+  float sampleRate;
+  uint64_t renderCount;
+  uint64_t frameCount;
+  uint64_t lastRenderNanos;
+  uint64_t maxRenderNanos;
+  uint64_t renderMicrosHistogram[histogramBuckets];
+  uint64_t nonFiniteResetCount;
+  uint64_t droppedLogCount;
+  float inputPeak;
+  float outputPeak;
+};
+
+/// One slot in the segment.
+struct Slot {
+  /// Sequence lock counter -- odd while the data is being updated
+  std::atomic<uint32_t> sequence;
+  /// Process ID of the owner of the slot, or 0 if the slot is free
+  std::atomic<int32_t> owner;
+  Data data;
+};
+
+/// Layout of the shared-memory segment.
+struct Segment {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint32_t slotCount;
+  uint32_t reserved;
+  Slot slots[maxSlots];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared-memory atomics must be lock-free");
+
+/**
+ Publishes the render statistics of one instance into a slot of the shared-memory segment.
+
+ Opening and closing happen on another thread while the render thread may be publishing. The render thread flags that
+ it is inside `recordRender` and only then loads the slot. `close` first takes the slot away and then waits for the
+ render thread to leave `recordRender` before it unmaps the segment. Both sides use sequentially-consistent operations,
+ so at least one of them sees the other: either the render thread sees no slot, or `close` sees it publishing and
+ waits, which takes at most one render.
+ */
+class Publisher : NonCopyable {
+public:
+  Publisher() = default;
+
+  ~Publisher() { close(); }
+
+  /**
+   Map the named segment (creating it if necessary) and claim a slot in it. Must not be called from the render thread.
+
+   @param name the name of the shared-memory segment (e.g. "/SimplyPhaser")
+   @param channelCount the number of channels being rendered
+   @param sampleRate the sample rate being rendered
+   @returns true if publishing is active
+   */
+  bool open(const std::string& name, uint32_t channelCount, float sampleRate) {
+    close();
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd == -1) return false;
+    struct stat info;
+    if (fstat(fd, &info) == -1 || (info.st_size < off_t(sizeof(Segment)) && ftruncate(fd, sizeof(Segment)) == -1)) {
+      ::close(fd);
+      return false;
+    }
+    void* memory = mmap(nullptr, sizeof(Segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) return false;
+    segment_ = static_cast<Segment*>(memory);
+
+    Slot* slot = initializeHeader() ? claimSlot() : nullptr;
+    if (slot == nullptr) {
+      close();
+      return false;
+    }
+
+    data_ = Data();
+    data_.channelCount = channelCount;
+    data_.sampleRate = sampleRate;
+    publish(*slot);
+    slot_.store(slot);
+    return true;
+  }
+
+  /**
+   Stop publishing, release the claimed slot and unmap the segment. Waits for a `recordRender` call that is in progress
+   on the render thread to finish first.
+   */
+  void close() {
+    if (segment_ == nullptr) return;
+    Slot* slot = slot_.exchange(nullptr);
+    while (recording_.load()) std::this_thread::yield();
+    if (slot != nullptr) slot->owner.store(0, std::memory_order_release);
+    munmap(segment_, sizeof(Segment));
+    segment_ = nullptr;
+  }
+
+  /// @returns true if publishing is active
+  bool isOpen() const { return slot_.load(std::memory_order_relaxed) != nullptr; }
+
+  /**
+   Record the statistics of one render and publish them. Safe to call from the render thread.
+
+   @param nanos the time it took to render
+   @param frameCount the number of frames rendered
+   @param inputPeak the peak absolute input sample value
+   @param outputPeak the peak absolute output sample value
+   @param nonFiniteResetCount the current count of NaN/Inf filter state resets
+   @param droppedLogCount the current count of dropped log statements
+   */
+  void recordRender(uint64_t nanos, uint32_t frameCount, float inputPeak, float outputPeak,
+                    uint64_t nonFiniteResetCount, uint64_t droppedLogCount) {
+    recording_.store(true);
+    Slot* slot = slot_.load();
+    if (slot == nullptr) {
+      recording_.store(false, std::memory_order_release);
+      return;
+    }
+    data_.renderCount += 1;
+    data_.frameCount += frameCount;
+    data_.lastRenderNanos = nanos;
+    if (nanos > data_.maxRenderNanos) data_.maxRenderNanos = nanos;
+    data_.renderMicrosHistogram[bucket(nanos / 1000)] += 1;
+    data_.nonFiniteResetCount = nonFiniteResetCount;
+    data_.droppedLogCount = droppedLogCount;
+    data_.inputPeak = inputPeak;
+    data_.outputPeak = outputPeak;
+    publish(*slot);
+    recording_.store(false, std::memory_order_release);
+  }
+
+  /**
+   Obtain the histogram bucket for a render duration.
+
+   @param micros render duration in microseconds
+   @returns bucket index
+   */
+  static uint32_t bucket(uint64_t micros) {
+    uint32_t index = 0;
+    while (micros > 1 && index < histogramBuckets - 1) {
+      micros >>= 1;
+      ++index;
+    }
+    return index;
+  }
+
+private:
+
+  /**
+   Make sure that the segment header is valid. The first process to map a new (zero-filled) segment claims the header
+   with a compare-and-swap, fills it in, and publishes the magic value last. Others wait for the magic value to
+   appear before they look at the rest of the header.
+
+   @returns true if the header is valid
+   */
+  bool initializeHeader() {
+    uint32_t magic = 0;
+    if (segment_->magic.compare_exchange_strong(magic, segmentInitializing, std::memory_order_acquire)) {
+      segment_->version = segmentVersion;
+      segment_->slotCount = maxSlots;
+      segment_->magic.store(segmentMagic, std::memory_order_release);
+      return true;
+    }
+    for (int attempt = 0; magic == segmentInitializing && attempt < 1000; ++attempt) {
+      std::this_thread::yield();
+      magic = segment_->magic.load(std::memory_order_acquire);
+    }
+    return magic == segmentMagic && segment_->version == segmentVersion && segment_->slotCount <= maxSlots;
+  }
+
+  Slot* claimSlot() {
+    int32_t pid = getpid();
+    for (uint32_t index = 0; index < segment_->slotCount; ++index) {
+      auto& slot = segment_->slots[index];
+      int32_t owner = slot.owner.load(std::memory_order_acquire);
+
+      // Take over slots left behind by processes that no longer exist
+      if (owner != 0 && kill(owner, 0) == -1 && errno == ESRCH &&
+          slot.owner.compare_exchange_strong(owner, 0, std::memory_order_acq_rel)) {
+        owner = 0;
+      }
+      if (owner == 0 && slot.owner.compare_exchange_strong(owner, pid, std::memory_order_acq_rel)) {
+        return &slot;
+      }
+    }
+    return nullptr;
+  }
+
+  void publish(Slot& slot) {
+    auto sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.data = data_;
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  Segment* segment_ = nullptr;
+  /// The claimed slot. Set last when opening and cleared first when closing.
+  std::atomic<Slot*> slot_{nullptr};
+  /// True while the render thread is in `recordRender`
+  std::atomic<bool> recording_{false};
+  Data data_;
+};
+
+/**
+ Reads the statistics of all publishing instances from the shared-memory segment. Intended for the monitoring process.
+ */
+class Reader : NonCopyable {
+public:
+  Reader() = default;
+
+  ~Reader() { close(); }
+
+  /**
+   Map an existing segment for reading.
+
+   @param name the name of the shared-memory segment
+   @returns true if successful
+   */
+  bool open(const std::string& name) {
+    close();
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd == -1) return false;
+    void* memory = mmap(nullptr, sizeof(Segment), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) return false;
+    segment_ = static_cast<Segment const*>(memory);
+    if (segment_->magic.load(std::memory_order_acquire) != segmentMagic || segment_->version != segmentVersion) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   Unmap the segment.
+   */
+  void close() {
+    if (segment_ == nullptr) return;
+    munmap(const_cast<Segment*>(segment_), sizeof(Segment));
+    segment_ = nullptr;
+  }
+
+  /**
+   Obtain a consistent copy of the statistics of every instance that is currently publishing.
+
+   @returns collection of (owner process ID, statistics) pairs
+   */
+  std::vector<std::pair<int32_t, Data>> sample() const {
+    std::vector<std::pair<int32_t, Data>> results;
+    if (segment_ == nullptr) return results;
+    for (uint32_t index = 0; index < segment_->slotCount; ++index) {
+      auto const& slot = segment_->slots[index];
+      auto owner = slot.owner.load(std::memory_order_acquire);
+      if (owner == 0) continue;
+      Data data;
+      if (read(slot, data)) results.emplace_back(owner, data);
+    }
+    return results;
+  }
+
+private:
+
+  static bool read(Slot const& slot, Data& data) {
+    for (int attempt = 0; attempt < 100; ++attempt) {
+      auto before = slot.sequence.load(std::memory_order_acquire);
+      if (before & 1) continue;
+      memcpy(&data, &slot.data, sizeof(Data));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      auto after = slot.sequence.load(std::memory_order_relaxed);
+      if (before == after) return true;
+    }
+    return false;
+  }
+
+  Segment const* segment_ = nullptr;
+};
+
+} // namespace Telemetry
@@ -111,6 +111,17 @@ extension MainViewController {
     bypassMenuItem?.title = isBypassed ? "Resume" : "Bypass"
   }
   
+  @IBAction private func tuneEngine(_ sender: NSMenuItem) {
+    // Benchmark the engine settings for this machine. The audio unit is loaded in this process, so it uses them the
+    // next time it is created.
+    sender.isEnabled = false
+    sender.title = "Tuning Engine…"
+    FilterAudioUnit.tuneEngine { _ in
+      sender.title = "Tune Engine"
+      sender.isEnabled = true
+    }
+  }
+  
   @objc private func handleSavePresetMenuSelection(_ sender: NSMenuItem) throws {
     guard let audioUnit = audioUnitManager.viewController.audioUnit else { return }
     guard let presetMenu = NSApplication.shared.mainMenu?.item(withTag: 666)?.submenu else { return }
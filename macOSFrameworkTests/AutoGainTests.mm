@@ -0,0 +1,99 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#import <XCTest/XCTest.h>
+#import <cmath>
+#import <vector>
+
+#import "AutoGain.h"
+
+@interface AutoGainTests : XCTestCase
+@end
+
+@implementation AutoGainTests
+
+- (void)testMeanSquare {
+  std::vector<double> ones(13, 1.0);
+  std::vector<double> halves(13, 0.5);
+  std::vector<double const*> buffers{ones.data(), halves.data()};
+  XCTAssertEqualWithAccuracy(AutoGain<double>::meanSquare(buffers, ones.size()), (1.0 + 0.25) / 2.0, 1.0e-12);
+  XCTAssertEqual(AutoGain<double>::meanSquare(buffers, 0), 0.0);
+  XCTAssertEqual(AutoGain<double>::meanSquare(std::vector<double const*>(), 13), 0.0);
+}
+
+- (void)testStartsAtUnity {
+  AutoGain<double> autoGain;
+  XCTAssertEqual(autoGain.gain(), 1.0);
+  autoGain.initialize(44100.0);
+  XCTAssertEqual(autoGain.gain(), 1.0);
+}
+
+- (void)testConvergesToInputLevel {
+  AutoGain<double> autoGain;
+  autoGain.initialize(44100.0);
+
+  // Output is twice as loud as the input, so the gain should settle at 1/2.
+  double inputPower = 0.01;
+  for (int block = 0; block < 1000; ++block) {
+    double outputPower = 4.0 * inputPower * autoGain.gain() * autoGain.gain();
+    autoGain.update(inputPower, outputPower, 512);
+  }
+  XCTAssertEqualWithAccuracy(autoGain.gain(), 0.5, 1.0e-3);
+
+  autoGain.reset();
+  XCTAssertEqual(autoGain.gain(), 1.0);
+}
+
+- (void)testGainIsLimited {
+  AutoGain<double> autoGain;
+  autoGain.initialize(44100.0);
+  for (int block = 0; block < 1000; ++block) {
+    autoGain.update(0.01, 1.0e-6 * autoGain.gain() * autoGain.gain(), 512);
+  }
+  XCTAssertEqualWithAccuracy(autoGain.gain(), AutoGain<double>::maxGain, 1.0e-3);
+}
+
+- (void)testHoldsDuringSilence {
+  AutoGain<double> autoGain;
+  autoGain.initialize(44100.0);
+  for (int block = 0; block < 1000; ++block) {
+    autoGain.update(0.01, 0.04 * autoGain.gain() * autoGain.gain(), 512);
+  }
+  auto gain = autoGain.gain();
+  for (int block = 0; block < 1000; ++block) {
+    autoGain.update(0.0, 0.0, 512);
+  }
+  XCTAssertEqual(autoGain.gain(), gain);
+}
+
+- (void)testIgnoresNonFinitePower {
+  AutoGain<double> autoGain;
+  autoGain.initialize(44100.0);
+  for (int block = 0; block < 100; ++block) {
+    autoGain.update(0.01, 0.04 * autoGain.gain() * autoGain.gain(), 512);
+  }
+  auto gain = autoGain.gain();
+  autoGain.update(NAN, 0.04 * gain * gain, 512);
+  autoGain.update(0.01, INFINITY, 512);
+  XCTAssertEqual(autoGain.gain(), gain);
+
+  // Measurements after the bad blocks still move the gain.
+  for (int block = 0; block < 1000; ++block) {
+    autoGain.update(0.01, 0.04 * autoGain.gain() * autoGain.gain(), 512);
+  }
+  XCTAssertEqualWithAccuracy(autoGain.gain(), 0.5, 1.0e-3);
+}
+
+- (void)testMeanSquarePerformance {
+  std::vector<double> samples(512);
+  for (size_t index = 0; index < samples.size(); ++index) samples[index] = std::sin(index / 10.0);
+  std::vector<double const*> buffers{samples.data(), samples.data()};
+  [self measureBlock:^{
+    double sum = 0.0;
+    for (int iteration = 0; iteration < 100000; ++iteration) {
+      sum += AutoGain<double>::meanSquare(buffers, samples.size());
+    }
+    XCTAssertTrue(std::isfinite(sum));
+  }];
+}
+
+@end
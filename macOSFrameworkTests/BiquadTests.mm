@@ -2,7 +2,12 @@
 
 #import <XCTest/XCTest.h>
 
+#import <vector>
+
 #import "Biquad.h"
+#import "BiquadCascade.h"
+#import "DSP.h"
+#import "TrigRecurrence.h"
 #import "fxobjects.h"
 
 #define SamplesEqual(A, B) XCTAssertEqualWithAccuracy(A, B, _epsilon)
@@ -201,4 +206,158 @@
   }
 }
 
+- (Biquad::Coefficients<double>)cascadeStage:(size_t)stage {
+  double sampleRate = 44100.0;
+  return stage % 2 ? Biquad::Coefficients<double>::APF2(sampleRate, 200.0 * (stage + 1), 0.707)
+  : Biquad::Coefficients<double>::APF1(sampleRate, 300.0 * (stage + 1));
+}
+
+- (std::vector<double>)cascadeInput {
+  std::vector<double> input(44100);
+  for (size_t index = 0; index < input.size(); ++index) {
+    input[index] = std::sin(index / 10.0) + 0.5 * std::sin(index / 3.0);
+  }
+  return input;
+}
+
+- (void)testWavefrontCascadeMatchesSequential {
+  constexpr size_t stageCount = 6;
+  std::vector<Biquad::CanonicalTranspose<double>> filters;
+  Biquad::WavefrontCascade<double, stageCount> cascade;
+  for (size_t stage = 0; stage < stageCount; ++stage) {
+    filters.emplace_back([self cascadeStage:stage]);
+    cascade.setCoefficients(stage, [self cascadeStage:stage]);
+  }
+
+  // Use block sizes that are smaller and larger than the number of stages
+  auto input = [self cascadeInput];
+  std::vector<double> output(input.size());
+  size_t blockSizes[] = {1, 3, 512, 7, 2, 1000, 64};
+  for (size_t position = 0, block = 0; position < input.size(); position += blockSizes[block++ % 7]) {
+    auto frameCount = std::min(blockSizes[block % 7], input.size() - position);
+    cascade.process(input.data() + position, output.data() + position, frameCount);
+  }
+
+  for (size_t index = 0; index < input.size(); ++index) {
+    double expected = input[index];
+    for (auto& filter : filters) expected = filter.transform(expected);
+    XCTAssertEqualWithAccuracy(output[index], expected, 1.0e-12);
+  }
+}
+
+- (void)testWavefrontCascadeInPlace {
+  Biquad::WavefrontCascade<double, 4> cascade([self cascadeStage:0]);
+  Biquad::WavefrontCascade<double, 4> other([self cascadeStage:0]);
+  auto input = [self cascadeInput];
+  auto buffer = input;
+  std::vector<double> output(input.size());
+  cascade.process(buffer.data(), buffer.data(), buffer.size());
+  other.process(input.data(), output.data(), input.size());
+  XCTAssertTrue(buffer == output);
+}
+
+- (void)testSequentialCascadePerformance {
+  std::vector<Biquad::CanonicalTranspose<double>> filters;
+  for (size_t stage = 0; stage < 8; ++stage) filters.emplace_back([self cascadeStage:stage]);
+  auto input = [self cascadeInput];
+  std::vector<double> output(input.size());
+  auto outputPtr = &output;
+  [self measureBlock:^{
+    auto localFilters = filters;
+    for (int iteration = 0; iteration < 20; ++iteration) {
+      for (size_t index = 0; index < input.size(); ++index) {
+        double sample = input[index];
+        for (auto& filter : localFilters) sample = filter.transform(sample);
+        (*outputPtr)[index] = sample;
+      }
+    }
+  }];
+  XCTAssertTrue(std::isfinite(output.back()));
+}
+
+- (void)testWavefrontCascadePerformance {
+  Biquad::WavefrontCascade<double, 8> cascade;
+  for (size_t stage = 0; stage < 8; ++stage) cascade.setCoefficients(stage, [self cascadeStage:stage]);
+  auto input = [self cascadeInput];
+  std::vector<double> output(input.size());
+  auto cascadePtr = &cascade;
+  auto outputPtr = &output;
+  [self measureBlock:^{
+    for (int iteration = 0; iteration < 20; ++iteration) {
+      for (size_t position = 0; position < input.size(); position += 512) {
+        auto frameCount = std::min<size_t>(512, input.size() - position);
+        cascadePtr->process(input.data() + position, outputPtr->data() + position, frameCount);
+      }
+    }
+  }];
+  XCTAssertTrue(std::isfinite(output.back()));
+}
+
+- (void)testTangentRecurrenceAccuracy {
+  DSP::TangentRecurrence<double> tangent;
+  double angle = 0.0;
+  for (int step = 0; step < 10000; ++step) {
+    // Sweep back and forth like a triangle LFO over most of (0, pi/2)
+    angle = 0.01 + 1.45 * std::abs(std::fmod(step * 0.003, 2.0) - 1.0);
+    XCTAssertEqualWithAccuracy(tangent(angle), std::tan(angle), 1.0e-12 * (1.0 + std::tan(angle)));
+  }
+
+  // A large jump is recalculated exactly
+  XCTAssertEqual(tangent(0.2), std::tan(0.2));
+}
+
+- (void)testSineCosineRecurrenceAccuracy {
+  DSP::SineCosineRecurrence<double> rotation;
+  for (int step = 0; step < 10000; ++step) {
+    double angle = 3.0 * std::abs(std::fmod(step * 0.004, 2.0) - 1.0);
+    rotation(angle);
+    XCTAssertEqualWithAccuracy(rotation.sine(), std::sin(angle), 1.0e-13);
+    XCTAssertEqualWithAccuracy(rotation.cosine(), std::cos(angle), 1.0e-13);
+  }
+}
+
+- (void)testAPFUpdatersMatchExactCoefficients {
+  double sampleRate = 44100.0;
+  Biquad::APF1Updater<double> apf1(sampleRate);
+  Biquad::APF2Updater<double> apf2(sampleRate);
+  for (int update = 0; update < 10000; ++update) {
+    double frequency = DSP::bipolarModulation(std::sin(update * 0.01), 260.0, 20480.0);
+    auto incremental1 = apf1(frequency);
+    auto exact1 = Biquad::Coefficients<double>::APF1(sampleRate, frequency);
+    XCTAssertEqualWithAccuracy(incremental1.a0, exact1.a0, 1.0e-12);
+    XCTAssertEqualWithAccuracy(incremental1.b1, exact1.b1, 1.0e-12);
+
+    auto incremental2 = apf2(frequency / 4.0, 0.707);
+    auto exact2 = Biquad::Coefficients<double>::APF2(sampleRate, frequency / 4.0, 0.707);
+    XCTAssertEqualWithAccuracy(incremental2.a0, exact2.a0, 1.0e-12);
+    XCTAssertEqualWithAccuracy(incremental2.a1, exact2.a1, 1.0e-12);
+    XCTAssertEqualWithAccuracy(incremental2.b2, exact2.b2, 1.0e-12);
+  }
+}
+
+- (void)testExactAPF1UpdatePerformance {
+  double sampleRate = 44100.0;
+  [self measureBlock:^{
+    double sum = 0.0;
+    for (int update = 0; update < 1000000; ++update) {
+      double frequency = 260.0 + (update % 2000) * 10.0;
+      sum += Biquad::Coefficients<double>::APF1(sampleRate, frequency).a0;
+    }
+    XCTAssertTrue(std::isfinite(sum));
+  }];
+}
+
+- (void)testIncrementalAPF1UpdatePerformance {
+  double sampleRate = 44100.0;
+  [self measureBlock:^{
+    Biquad::APF1Updater<double> updater(sampleRate);
+    double sum = 0.0;
+    for (int update = 0; update < 1000000; ++update) {
+      double frequency = 260.0 + (update % 2000) * 10.0;
+      sum += updater(frequency).a0;
+    }
+    XCTAssertTrue(std::isfinite(sum));
+  }];
+}
+
 @end
@@ -0,0 +1,113 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+import AVFoundation
+import XCTest
+@testable import SimplyPhaserFramework
+
+class CompressedRenderPipelineTests: XCTestCase {
+
+  private var directory: URL!
+  private let preset = FilterPreset(rate: 2.0, depth: 80, intensity: 75, dryMix: 50, wetMix: 50, odd90: 1,
+                                    logSweep: 0, voices: 1, sync: 0, unlinked: 0, autoGain: 0)
+
+  override func setUpWithError() throws {
+    directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+  }
+
+  override func tearDownWithError() throws {
+    try FileManager.default.removeItem(at: directory)
+  }
+
+  /// Write a few seconds of stereo noise to a WAV file.
+  private func makeInput(sampleRate: Double = 48000.0, seconds: Double = 3.0) throws -> URL {
+    let url = directory.appendingPathComponent("input.wav")
+    let format = AVAudioFormat(standardFormatWithSampleRate: sampleRate, channels: 2)!
+    let buffer = AVAudioPCMBuffer(pcmFormat: format, frameCapacity: AVAudioFrameCount(sampleRate * seconds))!
+    buffer.frameLength = buffer.frameCapacity
+    var seed: UInt32 = 1
+    for channel in 0..<Int(format.channelCount) {
+      for frame in 0..<Int(buffer.frameLength) {
+        seed = seed &* 1664525 &+ 1013904223
+        buffer.floatChannelData![channel][frame] = Float(seed >> 8) / Float(1 << 23) - 1.0
+      }
+    }
+    let file = try AVAudioFile(forWriting: url, settings: format.settings, commonFormat: .pcmFormatFloat32,
+                               interleaved: false)
+    try file.write(from: buffer)
+    return url
+  }
+
+  private func render(_ pipeline: CompressedRenderPipeline, jobs: [CompressedRenderPipeline.Job]) -> [Error?] {
+    let done = expectation(description: "rendered")
+    var errors = [Error?]()
+    pipeline.render(jobs: jobs) {
+      errors = $0
+      done.fulfill()
+    }
+    wait(for: [done], timeout: 60.0)
+    return errors
+  }
+
+  func testFlacOutputIsByteStable() throws {
+    let input = try makeInput()
+    let serial = CompressedRenderPipeline(chunkFrames: 4096, chunksAhead: 1)
+    let parallel = CompressedRenderPipeline(chunkFrames: 4096, chunksAhead: 8)
+    let outputs = (0..<6).map { directory.appendingPathComponent("output\($0).flac") }
+
+    let first = [CompressedRenderPipeline.Job(input: input, output: outputs[0], encoding: .flac(bitDepth: 24),
+                                              preset: preset)]
+    XCTAssertNil(render(serial, jobs: first)[0])
+
+    let rest = outputs.dropFirst().map {
+      CompressedRenderPipeline.Job(input: input, output: $0, encoding: .flac(bitDepth: 24), preset: preset)
+    }
+    XCTAssertTrue(render(parallel, jobs: rest).allSatisfy { $0 == nil })
+
+    let expected = try Data(contentsOf: outputs[0])
+    XCTAssertGreaterThan(expected.count, 0)
+    for output in outputs.dropFirst() {
+      XCTAssertEqual(try Data(contentsOf: output), expected)
+    }
+  }
+
+  func testChunkSizeDoesNotChangeOutput() throws {
+    let input = try makeInput()
+    let small = directory.appendingPathComponent("small.wav")
+    let large = directory.appendingPathComponent("large.wav")
+    XCTAssertNil(render(CompressedRenderPipeline(chunkFrames: 1000),
+                        jobs: [.init(input: input, output: small, encoding: .sameAsInput, preset: preset)])[0])
+    XCTAssertNil(render(CompressedRenderPipeline(chunkFrames: 65536),
+                        jobs: [.init(input: input, output: large, encoding: .sameAsInput, preset: preset)])[0])
+
+    let smallFile = try AVAudioFile(forReading: small)
+    let inputFile = try AVAudioFile(forReading: input)
+    XCTAssertGreaterThan(smallFile.length, inputFile.length)
+    XCTAssertEqual(try Data(contentsOf: small), try Data(contentsOf: large))
+  }
+
+  func testTailEndsAtThreshold() throws {
+    // With chunks of one kernel block, every tail call fills its buffer, so the end of the tail must come from the
+    // kernel and not from a short buffer. A threshold above any output level ends the tail after one block.
+    let input = try makeInput(seconds: 0.5)
+    let output = directory.appendingPathComponent("output.wav")
+    let pipeline = CompressedRenderPipeline(chunkFrames: 512, tailThreshold: 10.0)
+    XCTAssertNil(render(pipeline, jobs: [.init(input: input, output: output, encoding: .sameAsInput,
+                                               preset: preset)])[0])
+
+    let inputFile = try AVAudioFile(forReading: input)
+    let outputFile = try AVAudioFile(forReading: output)
+    XCTAssertEqual(outputFile.length, inputFile.length + 512)
+  }
+
+  func testOpusRejectsUnsupportedSampleRate() throws {
+    let input = try makeInput(sampleRate: 44100.0, seconds: 0.5)
+    let output = directory.appendingPathComponent("output.caf")
+    let errors = render(CompressedRenderPipeline(),
+                        jobs: [.init(input: input, output: output, encoding: .opus(bitRate: 96000), preset: preset)])
+    guard case .unsupportedSampleRate(44100.0)? = errors[0] as? CompressedRenderPipeline.Failure else {
+      XCTFail("expected unsupportedSampleRate")
+      return
+    }
+  }
+}
@@ -58,6 +58,22 @@
   }
 }
 
+- (void)testFastExp2Accuracy {
+  for (int index = -20000; index <= 20000; ++index) {
+    double exponent = index / 1000.0;
+    XCTAssertEqualWithAccuracy(DSP::fastExp2(exponent) / std::exp2(exponent), 1.0, 1.1e-7);
+  }
+}
+
+- (void)testBipolarExponentialModulation {
+  XCTAssertEqualWithAccuracy(DSP::bipolarExponentialModulation(-3.0, 10.0, 1000.0), 10.0, 1.0e-5);
+  XCTAssertEqualWithAccuracy(DSP::bipolarExponentialModulation(-1.0, 10.0, 1000.0), 10.0, 1.0e-5);
+  XCTAssertEqualWithAccuracy(DSP::bipolarExponentialModulation(0.0, 10.0, 1000.0), 100.0, 1.0e-5);
+  XCTAssertEqualWithAccuracy(DSP::bipolarExponentialModulation(0.5, 10.0, 1000.0), 316.227766, 1.0e-4);
+  XCTAssertEqualWithAccuracy(DSP::bipolarExponentialModulation(1.0, 10.0, 1000.0), 1000.0, 1.0e-4);
+  XCTAssertEqualWithAccuracy(DSP::bipolarExponentialModulation(3.0, 10.0, 1000.0), 1000.0, 1.0e-4);
+}
+
 //- (void)testZZZ {
 //    for (float modulator = -1.0; modulator <= 1.0; modulator += 0.1) {
 //        auto a = DSP::unipolarModulation<float>(DSP::bipolarToUnipolar<float>(modulator), 0.0, 10.0);
@@ -0,0 +1,105 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#import <XCTest/XCTest.h>
+#import <fstream>
+#import <string>
+
+#import "EngineWisdom.h"
+
+@interface EngineWisdomTests : XCTestCase
+@end
+
+@implementation EngineWisdomTests {
+  std::string path_;
+}
+
+- (void)setUp {
+  path_ = std::string(NSTemporaryDirectory().UTF8String) + "EngineWisdomTests.wisdom";
+  std::remove(path_.c_str());
+}
+
+- (void)tearDown {
+  std::remove(path_.c_str());
+}
+
+- (void)testDefaultsWithoutWisdom {
+  EngineWisdom wisdom;
+  XCTAssertTrue(wisdom.empty());
+  XCTAssertTrue(wisdom.settings(44100.0) == EngineWisdom::defaults);
+  XCTAssertFalse(wisdom.load(path_));
+  XCTAssertTrue(wisdom.empty());
+}
+
+- (void)testSaveAndLoad {
+  EngineWisdom wisdom;
+  wisdom.set(44100.0, EngineWisdom::Settings{12, 32});
+  wisdom.set(96000.0, EngineWisdom::Settings{24, 128});
+  XCTAssertTrue(wisdom.save(path_));
+
+  EngineWisdom loaded;
+  XCTAssertTrue(loaded.load(path_));
+  XCTAssertTrue(loaded.settings(44100.0) == (EngineWisdom::Settings{12, 32}));
+  XCTAssertTrue(loaded.settings(96000.0) == (EngineWisdom::Settings{24, 128}));
+  XCTAssertTrue(loaded.settings(48000.0) == EngineWisdom::defaults);
+}
+
+- (void)testRejectsOtherMachine {
+  std::ofstream(path_) << "version " << EngineWisdom::fileVersion << "\nmachine Some Other CPU\nentry 44100 12 32\n";
+  EngineWisdom wisdom;
+  XCTAssertFalse(wisdom.load(path_));
+  XCTAssertTrue(wisdom.settings(44100.0) == EngineWisdom::defaults);
+}
+
+- (void)testRejectsInvalidFile {
+  EngineWisdom wisdom;
+  wisdom.set(44100.0, EngineWisdom::Settings{12, 32});
+
+  std::ofstream(path_) << "version " << EngineWisdom::fileVersion << "\nmachine " << EngineWisdom::machineSignature()
+  << "\nentry 48000 0 32\n";
+  XCTAssertFalse(wisdom.load(path_));
+
+  std::ofstream(path_) << "version " << (EngineWisdom::fileVersion + 1) << "\nmachine "
+  << EngineWisdom::machineSignature() << "\nentry 48000 16 32\n";
+  XCTAssertFalse(wisdom.load(path_));
+
+  // Settings are only replaced by a valid file.
+  XCTAssertTrue(wisdom.settings(44100.0) == (EngineWisdom::Settings{12, 32}));
+  XCTAssertTrue(wisdom.settings(48000.0) == EngineWisdom::defaults);
+}
+
+- (void)testLossGrowsWithUpdateInterval {
+  EngineWisdom::Benchmark benchmark(44100.0, 0.25);
+  XCTAssertEqualWithAccuracy(benchmark.loss(EngineWisdom::reference), 0.0, 1.0e-12);
+  XCTAssertEqualWithAccuracy(benchmark.loss(EngineWisdom::Settings{1, 64}), 0.0, 1.0e-9);
+  auto previous = 0.0;
+  for (auto samplesPerFilterUpdate : {2, 8, 32}) {
+    auto loss = benchmark.loss(EngineWisdom::Settings{samplesPerFilterUpdate, 64});
+    XCTAssertGreaterThan(loss, previous);
+    previous = loss;
+  }
+}
+
+- (void)testBudgetDependsOnSampleRate {
+  // The budget must be a real choice: it rejects the longest update intervals at 44.1 kHz but allows intervals longer
+  // than the default one at 96 kHz, where the same number of samples is a shorter time.
+  EngineWisdom::Benchmark low(44100.0, 0.25);
+  auto lowBudget = low.loss(EngineWisdom::reference) + EngineWisdom::accuracyTolerance;
+  XCTAssertLessThanOrEqual(low.loss(EngineWisdom::defaults), lowBudget);
+  XCTAssertGreaterThan(low.loss(EngineWisdom::Settings{64, 64}), lowBudget);
+
+  EngineWisdom::Benchmark high(96000.0, 0.25);
+  auto highBudget = high.loss(EngineWisdom::reference) + EngineWisdom::accuracyTolerance;
+  XCTAssertLessThanOrEqual(high.loss(EngineWisdom::Settings{64, 64}), highBudget);
+}
+
+- (void)testTunedSettingsAreWithinBudget {
+  EngineWisdom::Benchmark benchmark(48000.0, 0.25);
+  auto budget = benchmark.loss(EngineWisdom::reference) + EngineWisdom::accuracyTolerance;
+  auto settings = EngineWisdom::tune(48000.0, 0.25);
+  XCTAssertLessThanOrEqual(benchmark.loss(settings), budget);
+
+  // No candidate can be exactly as accurate as the reference, so the defaults are used.
+  XCTAssertTrue(EngineWisdom::tune(48000.0, 0.0, 0.25) == EngineWisdom::defaults);
+}
+
+@end
@@ -4,6 +4,8 @@
 #import <vector>
 
 #import "LFO.h"
+#import "MusicalContext.h"
+#import "QuadratureOscillator.h"
 
 #define SamplesEqual(A, B) XCTAssertEqualWithAccuracy(A, B, _epsilon)
 
@@ -88,7 +90,7 @@
   SamplesEqual(osc.quadPhaseValue(), -0.50);
   SamplesEqual(osc.valueAndIncrement(), -0.75);
   SamplesEqual(osc.quadPhaseValue(), -0.25);
-  float state = osc.saveState();
+  auto state = osc.saveState();
   SamplesEqual(osc.valueAndIncrement(), -0.50);
   SamplesEqual(osc.quadPhaseValue(),  0.00);
   SamplesEqual(osc.valueAndIncrement(), -0.25);
@@ -100,4 +102,210 @@
   SamplesEqual(osc.quadPhaseValue(),  0.25);
 }
 
+- (void)testNegativeFrequency {
+  LFO<float> osc(8.0, -1.0, LFOWaveform::sawtooth);
+  SamplesEqual(osc.valueAndIncrement(), -1.00);
+  SamplesEqual(osc.valueAndIncrement(),  0.75);
+  SamplesEqual(osc.valueAndIncrement(),  0.50);
+  SamplesEqual(osc.valueAndIncrement(),  0.25);
+  SamplesEqual(osc.valueAndIncrement(),  0.00);
+  SamplesEqual(osc.valueAndIncrement(), -0.25);
+  SamplesEqual(osc.valueAndIncrement(), -0.50);
+  SamplesEqual(osc.valueAndIncrement(), -0.75);
+  SamplesEqual(osc.valueAndIncrement(), -1.00);
+}
+
+- (void)testSetPhase {
+  LFO<double> osc(8.0, 1.0, LFOWaveform::sawtooth);
+  osc.setPhase(0.25);
+  XCTAssertEqual(osc.phase(), 0.25);
+  XCTAssertEqual(osc.value(), -0.5);
+  XCTAssertEqual(osc.quadPhaseValue(), 0.0);
+  osc.setPhase(1.25);
+  XCTAssertEqual(osc.phase(), 0.25);
+  osc.setPhase(-0.25);
+  XCTAssertEqual(osc.phase(), 0.75);
+  XCTAssertEqual(osc.quadPhaseValue(), -1.0);
+  osc.setPhase(1.0);
+  XCTAssertEqual(osc.phase(), 0.0);
+}
+
+- (void)testQuadPhaseIsConstantOffset {
+  LFO<double> lfo(44100.0, 3.3, LFOWaveform::triangle);
+  LFO<double> ahead(44100.0, 3.3, LFOWaveform::triangle);
+  ahead.setPhase(0.25);
+  for (int counter = 0; counter < 100'000; ++counter) {
+    lfo.valueAndIncrement();
+    XCTAssertEqual(lfo.quadPhaseValue(), ahead.valueAndIncrement());
+  }
+}
+
+- (void)testExactPeriod {
+  // A frequency that is a power-of-two fraction of the sample rate has an increment with no rounding, so the phase
+  // comes back to exactly where it started after every cycle, no matter how many cycles have passed.
+  LFO<double> lfo(48000.0, 48000.0 / 64.0, LFOWaveform::triangle);
+  auto start = lfo.saveState();
+  auto first = lfo.value();
+  for (int cycle = 0; cycle < 100'000; ++cycle) {
+    for (int counter = 0; counter < 64; ++counter) lfo.increment();
+    XCTAssertEqual(lfo.saveState(), start);
+  }
+  XCTAssertEqual(lfo.value(), first);
+}
+
+- (void)testMatchesFloatingPointPhase {
+  // The integer phase tracks the ideal phase over a long run to within the resolution of the phase increment.
+  double sampleRate = 44100.0;
+  double frequency = 3.3;
+  LFO<double> lfo(sampleRate, frequency, LFOWaveform::sinusoid);
+  double worst = 0.0;
+  for (long counter = 0; counter < 10'000'000; ++counter) {
+    long double cycles = counter * (long double)frequency / sampleRate;
+    double error = lfo.phase() - double(cycles - std::floor(cycles));
+    if (error > 0.5) error -= 1.0;
+    if (error < -0.5) error += 1.0;
+    worst = std::max(worst, std::abs(error));
+    lfo.increment();
+  }
+  XCTAssertLessThan(worst, 1.0e-12);
+}
+
+- (void)testQuadratureSamples {
+  QuadratureOscillator<float> osc(4.0, 1.0);
+  SamplesEqual(osc.quadPhaseValue(),  1.0);
+  SamplesEqual(osc.valueAndIncrement(),  0.0);
+  SamplesEqual(osc.quadPhaseValue(),  0.0);
+  SamplesEqual(osc.valueAndIncrement(),  1.0);
+  SamplesEqual(osc.quadPhaseValue(), -1.0);
+  SamplesEqual(osc.valueAndIncrement(),  0.0);
+  SamplesEqual(osc.quadPhaseValue(),  0.0);
+  SamplesEqual(osc.valueAndIncrement(), -1.0);
+  SamplesEqual(osc.quadPhaseValue(),  1.0);
+  SamplesEqual(osc.valueAndIncrement(),  0.0);
+}
+
+- (void)testSinusoidFollowsPhase {
+  // The sinusoid comes from a QuadratureOscillator, which must stay on the exact phase of the LFO through frequency
+  // changes, phase changes, and state restores.
+  LFO<double> lfo(44100.0, 3.3, LFOWaveform::sinusoid);
+  double worst = 0.0;
+  for (int counter = 0; counter < 1'000'000; ++counter) {
+    if (counter == 300'000) lfo.setFrequency(17.0);
+    if (counter == 600'000) lfo.setPhase(0.8);
+    if (counter == 700'000) lfo.restoreState(lfo.saveState() + (LFO<double>::Phase(1) << 61));
+    double theta = 2.0 * M_PI * lfo.phase();
+    worst = std::max(worst, std::abs(lfo.quadPhaseValue() - std::cos(theta)));
+    worst = std::max(worst, std::abs(lfo.valueAndIncrement() - std::sin(theta)));
+  }
+  XCTAssertLessThan(worst, 1.0e-12);
+}
+
+- (void)testSinusoidIsMoreAccurateThanParabolicSine {
+  LFO<double> lfo(44100.0, 3.3, LFOWaveform::sinusoid);
+  double worstParabolic = 0.0;
+  double worst = 0.0;
+  for (int counter = 0; counter < 44100; ++counter) {
+    double theta = 2.0 * M_PI * lfo.phase();
+    worstParabolic = std::max(worstParabolic, std::abs(DSP::parabolicSine(M_PI - theta) - std::sin(theta)));
+    worst = std::max(worst, std::abs(lfo.valueAndIncrement() - std::sin(theta)));
+  }
+  XCTAssertGreaterThan(worstParabolic, 1.0e-4);
+  XCTAssertLessThan(worst, 1.0e-12);
+}
+
+- (void)testQuadratureAccuracy {
+  double sampleRate = 44100.0;
+  double frequency = 3.3;
+  QuadratureOscillator<double> osc(sampleRate, frequency);
+  double worstSin = 0.0;
+  double worstCos = 0.0;
+  for (long counter = 0; counter < 10'000'000; ++counter) {
+    long double cycles = counter * (long double)frequency / sampleRate;
+    double theta = double(2.0 * M_PI * (cycles - std::floor(cycles)));
+    worstSin = std::max(worstSin, std::abs(osc.value() - std::sin(theta)));
+    worstCos = std::max(worstCos, std::abs(osc.quadPhaseValue() - std::cos(theta)));
+    osc.increment();
+  }
+  XCTAssertLessThan(worstSin, 1.0e-9);
+  XCTAssertLessThan(worstCos, 1.0e-9);
+}
+
+- (void)testQuadratureFill {
+  QuadratureOscillator<double> osc1(44100.0, 5.0);
+  QuadratureOscillator<double> osc2(44100.0, 5.0);
+  std::vector<double> values(1000);
+  std::vector<double> quadPhaseValues(1000);
+  osc1.fill(values.data(), quadPhaseValues.data(), values.size());
+  for (size_t index = 0; index < values.size(); ++index) {
+    XCTAssertEqual(values[index], osc2.value());
+    XCTAssertEqual(quadPhaseValues[index], osc2.quadPhaseValue());
+    osc2.increment();
+  }
+  XCTAssertEqual(osc1.value(), osc2.value());
+}
+
+- (void)testMusicalContext {
+  MusicalContext context;
+  XCTAssertFalse(context.isValid());
+  context.tempo = 120.0;
+  context.beatPosition = 10.0;
+  XCTAssertTrue(context.isValid());
+  XCTAssertEqualWithAccuracy(context.beatsAt(22050.0, 44100.0), 11.0, 1.0e-12);
+  XCTAssertEqualWithAccuracy(context.frequency(4.0), 0.5, 1.0e-12);
+  XCTAssertEqualWithAccuracy(MusicalContext::phase(10.0, 4.0), 0.5, 1.0e-12);
+  XCTAssertEqualWithAccuracy(MusicalContext::phase(11.0, 0.25), 0.0, 1.0e-12);
+  XCTAssertEqualWithAccuracy(MusicalContext::phase(-1.0, 4.0), 0.75, 1.0e-12);
+}
+
+- (void)testBeatLockedPhaseCoherence {
+  // Two LFOs that start at different song positions and are re-anchored from the beat position at the start of every
+  // block agree on every sample.
+  double sampleRate = 48000.0;
+  double beatsPerCycle = 1.0;
+  MusicalContext context{137.0, 0.0};
+  LFO<double> early(sampleRate, 1.0, LFOWaveform::triangle);
+  LFO<double> late(sampleRate, 1.0, LFOWaveform::triangle);
+  int blockSize = 512;
+  double maxDifference = 0.0;
+  for (int block = 0; block < 100000; ++block) {
+    double beats = context.beatsAt(double(block) * blockSize, sampleRate);
+    for (auto lfo : {&early, &late}) {
+      if (lfo == &late && block < 1000) continue;
+      lfo->setFrequency(context.frequency(beatsPerCycle));
+      lfo->setPhase(MusicalContext::phase(beats, beatsPerCycle));
+    }
+    for (int frame = 0; frame < blockSize; ++frame) {
+      double value = early.valueAndIncrement();
+      if (block >= 1000) maxDifference = std::max(maxDifference, std::abs(value - late.valueAndIncrement()));
+    }
+  }
+  XCTAssertEqual(maxDifference, 0.0);
+}
+
+- (void)testSinusoidPerformance {
+  __block LFO<double> lfo(44100.0, 3.3, LFOWaveform::sinusoid);
+  [self measureBlock:^{
+    double sum = 0.0;
+    for (int counter = 0; counter < 1'000'000; ++counter) {
+      sum += lfo.value() + lfo.quadPhaseValue();
+      lfo.increment();
+    }
+    XCTAssertTrue(std::isfinite(sum));
+  }];
+}
+
+- (void)testQuadraturePerformance {
+  __block QuadratureOscillator<double> osc(44100.0, 3.3);
+  __block std::vector<double> values(1000);
+  __block std::vector<double> quadPhaseValues(1000);
+  [self measureBlock:^{
+    double sum = 0.0;
+    for (int block = 0; block < 1'000; ++block) {
+      osc.fill(values.data(), quadPhaseValues.data(), values.size());
+      sum += values.back() + quadPhaseValues.back();
+    }
+    XCTAssertTrue(std::isfinite(sum));
+  }];
+}
+
 @end
@@ -0,0 +1,115 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#import <XCTest/XCTest.h>
+#import <array>
+#import <cmath>
+#import <vector>
+
+#import "LFO.h"
+#import "MultiVoicePhaseShifter.h"
+#import "PhaseShifter.h"
+
+@interface MultiVoicePhaseShifterTests : XCTestCase
+@end
+
+@implementation MultiVoicePhaseShifterTests
+
+- (void)setUp {
+  self.continueAfterFailure = false;
+}
+
+- (void)testSingleVoiceMatchesPhaseShifter {
+  double sampleRate = 44100.0;
+  LFO<double> lfo(sampleRate, 0.5, LFOWaveform::triangle);
+  PhaseShifter<double> single{PhaseShifter<double>::ideal, sampleRate, 0.9, 20};
+  MultiVoicePhaseShifter<double> multi{PhaseShifter<double>::ideal, sampleRate, 0.9, 20};
+  for (int counter = 0; counter < 44100; ++counter) {
+    double input = std::sin(counter / 10.0);
+    double modulation = lfo.value();
+    lfo.increment();
+    double output1 = single.process(modulation, input);
+    double output2 = multi.process([modulation](int voice) { return modulation; }, input);
+    XCTAssertEqualWithAccuracy(output1, output2, 1.0e-12);
+  }
+}
+
+- (void)testVoicesSpreadOutput {
+  double sampleRate = 44100.0;
+  MultiVoicePhaseShifter<double> one{PhaseShifter<double>::ideal, sampleRate, 0.9, 20};
+  MultiVoicePhaseShifter<double> four{PhaseShifter<double>::ideal, sampleRate, 0.9, 20};
+  four.setVoiceCount(4);
+  XCTAssertEqual(four.voiceCount(), 4);
+
+  // With identical modulation the only difference between the voices is their band scaling.
+  double difference = 0.0;
+  for (int counter = 0; counter < 4410; ++counter) {
+    double input = std::sin(counter / 10.0);
+    auto modulation = [](int voice) { return 0.0; };
+    difference = std::max(difference, std::abs(one.process(modulation, input) - four.process(modulation, input)));
+  }
+  XCTAssertGreaterThan(difference, 0.01);
+  XCTAssertTrue(four.isFinite());
+
+  four.setVoiceCount(10);
+  XCTAssertEqual(four.voiceCount(), 4);
+  four.setVoiceCount(0);
+  XCTAssertEqual(four.voiceCount(), 1);
+}
+
+- (void)testResetRendersSameSamples {
+  // See PhaseShifterTests.testResetRendersSameSamples
+  double sampleRate = 44100.0;
+  std::array<LFO<double>, 4> lfos;
+  for (int voice = 0; voice < 4; ++voice) {
+    lfos[voice].initialize(sampleRate, 2.0 + 0.1 * voice);
+    lfos[voice].setWaveform(LFOWaveform::triangle);
+  }
+  MultiVoicePhaseShifter<double> phaseShifter{PhaseShifter<double>::ideal, sampleRate, 0.9, 10, 64};
+  phaseShifter.setVoiceCount(4);
+  phaseShifter.reset();
+  auto modulation = [&lfos](int voice) { return lfos[voice].value(); };
+  std::vector<double> first;
+  for (int counter = 0; counter < 44100; ++counter) {
+    first.push_back(phaseShifter.process(modulation, std::sin(counter / 10.0)));
+    for (auto& lfo : lfos) lfo.increment();
+  }
+
+  for (auto& lfo : lfos) lfo.reset();
+  phaseShifter.reset();
+  for (int counter = 0; counter < 44100; ++counter) {
+    XCTAssertEqual(phaseShifter.process(modulation, std::sin(counter / 10.0)), first[counter]);
+    for (auto& lfo : lfos) lfo.increment();
+  }
+}
+
+- (void)doVoices:(int)voiceCount {
+  double sampleRate = 44100.0;
+  std::array<LFO<double>, 4> lfos;
+  for (int voice = 0; voice < 4; ++voice) {
+    lfos[voice].initialize(sampleRate, 1.0 + 0.05 * voice);
+    lfos[voice].setWaveform(LFOWaveform::triangle);
+  }
+  MultiVoicePhaseShifter<double> phaseShifter{PhaseShifter<double>::ideal, sampleRate, 0.9, 20};
+  phaseShifter.setVoiceCount(voiceCount);
+  auto modulation = [&lfos](int voice) { return lfos[voice].value(); };
+  double sum = 0.0;
+  for (int counter = 0; counter < 441000; ++counter) {
+    sum += phaseShifter.process(modulation, std::sin(counter / 10.0));
+    for (int voice = 0; voice < voiceCount; ++voice) lfos[voice].increment();
+  }
+  XCTAssertTrue(std::isfinite(sum));
+}
+
+- (void)testOneVoicePerformance {
+  [self measureBlock:^{
+    [self doVoices:1];
+  }];
+}
+
+- (void)testFourVoicePerformance {
+  [self measureBlock:^{
+    [self doVoices:4];
+  }];
+}
+
+@end
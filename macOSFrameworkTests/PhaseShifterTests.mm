@@ -1,7 +1,10 @@
 // Copyright © 2021 Brad Howes. All rights reserved.
 
 #import <XCTest/XCTest.h>
+#import <chrono>
 #import <cmath>
+#import <limits>
+#import <vector>
 
 #import "fxobjects.h"
 #import "LFO.h"
@@ -49,6 +52,52 @@
   }
 }
 
+- (void)testNonFiniteRecovery {
+  double sampleRate = 44100.0;
+  LFO<double> lfo(sampleRate, 1.0, LFOWaveform::triangle);
+  PhaseShifter<double> phaseShifter{PhaseShifter<double>::ideal, sampleRate, 0.9, 20};
+  for (int counter = 0; counter < 1000; ++counter) {
+    phaseShifter.process(lfo.valueAndIncrement(), std::sin(counter / 10.0));
+  }
+  XCTAssertTrue(phaseShifter.isFinite());
+  
+  phaseShifter.process(lfo.valueAndIncrement(), std::numeric_limits<double>::quiet_NaN());
+  for (int counter = 0; counter < 1000; ++counter) {
+    phaseShifter.process(lfo.valueAndIncrement(), std::sin(counter / 10.0));
+  }
+  XCTAssertFalse(phaseShifter.isFinite());
+  
+  phaseShifter.reset();
+  XCTAssertTrue(phaseShifter.isFinite());
+  for (int counter = 0; counter < 1000; ++counter) {
+    XCTAssertTrue(std::isfinite(phaseShifter.process(lfo.valueAndIncrement(), std::sin(counter / 10.0))));
+  }
+  XCTAssertTrue(phaseShifter.isFinite());
+  
+  phaseShifter.process(lfo.valueAndIncrement(), std::numeric_limits<double>::infinity());
+  phaseShifter.process(lfo.valueAndIncrement(), 0.0);
+  XCTAssertFalse(phaseShifter.isFinite());
+}
+
+- (void)testResetRendersSameSamples {
+  // The coefficient updaters carry state from one update to the next, so a reset must start them over as well for the
+  // samples after it to match those of the first run bit for bit. The run stops part way into an LFO cycle so that the
+  // updaters are not left where a new instance would start.
+  double sampleRate = 44100.0;
+  LFO<double> lfo(sampleRate, 0.7, LFOWaveform::triangle);
+  PhaseShifter<double> phaseShifter{PhaseShifter<double>::ideal, sampleRate, 0.9, 10, 64};
+  std::vector<double> first;
+  for (int counter = 0; counter < 20000; ++counter) {
+    first.push_back(phaseShifter.process(lfo.valueAndIncrement(), std::sin(counter / 10.0)));
+  }
+
+  lfo.reset();
+  phaseShifter.reset();
+  for (int counter = 0; counter < 20000; ++counter) {
+    XCTAssertEqual(phaseShifter.process(lfo.valueAndIncrement(), std::sin(counter / 10.0)), first[counter]);
+  }
+}
+
 - (void)doPhaseShifting {
   double sampleRate = 44100.0;
   double lfoFrequency = 0.2;
@@ -62,6 +111,110 @@
   }
 }
 
+- (void)doSweep:(bool)exponential {
+  double sampleRate = 44100.0;
+  LFO<double> lfo(sampleRate, 1.0, LFOWaveform::triangle);
+  PhaseShifter<double> phaseShifter{PhaseShifter<double>::ideal, sampleRate, 1.0, 1};
+  phaseShifter.setExponentialSweep(exponential);
+  double sum = 0.0;
+  for (int counter = 0; counter < 441000; ++counter) {
+    double input = std::sin(counter/100.0 * M_PI / 180.0 );
+    sum += phaseShifter.process(lfo.valueAndIncrement(), input);
+  }
+  XCTAssertTrue(std::isfinite(sum));
+}
+
+- (void)testSweepChangeWhileStatic {
+  // Coefficients are not recalculated while the modulation stays the same, so make sure that a change to the sweep
+  // mapping still takes effect.
+  double sampleRate = 44100.0;
+  PhaseShifter<double> switched{PhaseShifter<double>::ideal, sampleRate, 0.9, 1};
+  PhaseShifter<double> exponential{PhaseShifter<double>::ideal, sampleRate, 0.9, 1};
+  exponential.setExponentialSweep(true);
+  double output1 = 0.0;
+  double output2 = 0.0;
+  for (int counter = 0; counter < 44100; ++counter) {
+    if (counter == 100) switched.setExponentialSweep(true);
+    double input = std::sin(counter / 10.0);
+    output1 = switched.process(0.5, input);
+    output2 = exponential.process(0.5, input);
+  }
+  XCTAssertEqualWithAccuracy(output1, output2, 1.0e-9);
+}
+
+- (void)testSweepFrequencies {
+  PhaseShifter<double> phaseShifter{PhaseShifter<double>::ideal, 44100.0, 0.9, 1};
+  for (int index = -150; index <= 150; ++index) {
+    double modulation = index / 100.0;
+    double clamped = std::clamp(modulation, -1.0, 1.0);
+    for (size_t band = 0; band < PhaseShifter<double>::ideal.size(); ++band) {
+      auto const& range = PhaseShifter<double>::ideal[band];
+      phaseShifter.setExponentialSweep(true);
+      double expected = range.frequencyMin * std::exp2((clamped + 1.0) / 2.0 *
+                                                       std::log2(range.frequencyMax / range.frequencyMin));
+      XCTAssertEqualWithAccuracy(phaseShifter.frequency(band, modulation) / expected, 1.0, 1.1e-7);
+      phaseShifter.setExponentialSweep(false);
+      expected = range.frequencyMin + (clamped + 1.0) / 2.0 * (range.frequencyMax - range.frequencyMin);
+      XCTAssertEqualWithAccuracy(phaseShifter.frequency(band, modulation), expected, 1.0e-9);
+    }
+  }
+}
+
+- (double)sweepSeconds:(bool)exponential {
+  // Use the update interval of the kernel, and take the best of several runs since it is the least disturbed by other
+  // activity on the machine.
+  double sampleRate = 44100.0;
+  double best = std::numeric_limits<double>::max();
+  for (int run = 0; run < 5; ++run) {
+    LFO<double> lfo(sampleRate, 1.0, LFOWaveform::triangle);
+    PhaseShifter<double> phaseShifter{PhaseShifter<double>::ideal, sampleRate, 1.0, 20};
+    phaseShifter.setExponentialSweep(exponential);
+    double sum = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (int counter = 0; counter < 441000; ++counter) {
+      sum += phaseShifter.process(lfo.valueAndIncrement(), std::sin(counter / 10.0));
+    }
+    best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    XCTAssertTrue(std::isfinite(sum));
+  }
+  return best;
+}
+
+- (void)testExponentialSweepCostComparedToLinear {
+  double linear = [self sweepSeconds:false];
+  double exponential = [self sweepSeconds:true];
+  NSLog(@"linear sweep: %.2f ms exponential sweep: %.2f ms ratio: %.3f", linear * 1.0e3, exponential * 1.0e3,
+        exponential / linear);
+  // The two mappings only differ once per coefficient update, so the difference is small. The bound is loose so that
+  // a busy machine does not fail the test.
+  XCTAssertLessThan(exponential / linear, 1.5);
+}
+
+- (void)testStaticModulationPerformance {
+  double sampleRate = 44100.0;
+  PhaseShifter<double> phaseShifter{PhaseShifter<double>::ideal, sampleRate, 0.9, 1};
+  auto phaseShifterPtr = &phaseShifter;
+  [self measureBlock:^{
+    double sum = 0.0;
+    for (int counter = 0; counter < 441000; ++counter) {
+      sum += phaseShifterPtr->process(0.0, std::sin(counter / 10.0));
+    }
+    XCTAssertTrue(std::isfinite(sum));
+  }];
+}
+
+- (void)testLinearSweepPerformance {
+  [self measureBlock:^{
+    [self doSweep:false];
+  }];
+}
+
+- (void)testExponentialSweepPerformance {
+  [self measureBlock:^{
+    [self doSweep:true];
+  }];
+}
+
 - (void)testPerformanceExample {
   [self measureBlock:^{
     [self testPhaseShifters];
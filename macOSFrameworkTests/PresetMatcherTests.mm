@@ -0,0 +1,89 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#import <XCTest/XCTest.h>
+#import <cmath>
+#import <vector>
+
+#import "PresetMatcher.h"
+
+@interface PresetMatcherTests : XCTestCase
+@end
+
+@implementation PresetMatcherTests {
+  AVAudioFormat* format_;
+  std::vector<std::vector<AUValue>> dry_;
+}
+
+- (void)setUp {
+  format_ = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:44100.0 channels:2];
+  size_t frameCount = 4096;
+  dry_.assign(2, std::vector<AUValue>(frameCount));
+  uint32_t seed = 1;
+  for (size_t frame = 0; frame < frameCount; ++frame) {
+    for (auto& channel : dry_) {
+      seed = seed * 1664525u + 1013904223u;
+      channel[frame] = seed / 4294967296.0 - 0.5;
+    }
+  }
+}
+
+/**
+ Render the dry clip with the given settings, the way the matcher renders its candidates.
+ */
+- (std::vector<std::vector<AUValue>>)render:(const PresetMatcher::Settings&)settings {
+  SimplyPhaserKernel kernel("PresetMatcherTests");
+  kernel.startProcessing(format_, 512);
+  kernel.setParameterValue(FilterParameterAddressRate, settings.rate);
+  kernel.setParameterValue(FilterParameterAddressDepth, settings.depth);
+  kernel.setParameterValue(FilterParameterAddressIntensity, settings.intensity);
+  kernel.setParameterValue(FilterParameterAddressDryMix, settings.dryMix);
+  kernel.setParameterValue(FilterParameterAddressWetMix, settings.wetMix);
+  kernel.setParameterValue(FilterParameterAddressOdd90, settings.odd90);
+
+  std::vector<std::vector<AUValue>> output(dry_.size(), std::vector<AUValue>(dry_[0].size()));
+  std::vector<AUValue const*> ins;
+  std::vector<AUValue*> outs;
+  for (auto const& channel : dry_) ins.push_back(channel.data());
+  for (auto& channel : output) outs.push_back(channel.data());
+  kernel.renderClip(ins, outs, dry_[0].size(), 0, 0.0, settings.lfoPhase);
+  return output;
+}
+
+- (void)testDecode {
+  auto settings = PresetMatcher::decode({0.0, 0.5, 1.0, 0.25, 0.75, 1.25}, true);
+  XCTAssertEqualWithAccuracy(settings.rate, 0.02, 1.0e-6);
+  XCTAssertEqualWithAccuracy(settings.depth, 50.0, 1.0e-4);
+  XCTAssertEqualWithAccuracy(settings.intensity, 100.0, 1.0e-4);
+  XCTAssertEqualWithAccuracy(settings.dryMix, 25.0, 1.0e-4);
+  XCTAssertEqualWithAccuracy(settings.wetMix, 75.0, 1.0e-4);
+  XCTAssertEqual(settings.odd90, 1.0);
+  XCTAssertEqualWithAccuracy(settings.lfoPhase, 0.25, 1.0e-12);
+  XCTAssertEqualWithAccuracy(PresetMatcher::decode({1.0, 0, 0, 0, 0, 0}, false).rate, 20.0, 1.0e-4);
+}
+
+- (void)testTargetSettingsHaveNoLoss {
+  PresetMatcher::Settings truth{2.5, 80.0, 70.0, 40.0, 60.0, 1.0, 0.3};
+  PresetMatcher matcher("PresetMatcherTests", format_, dry_, [self render:truth]);
+  XCTAssertEqualWithAccuracy(matcher.loss(truth), 0.0, 1.0e-9);
+
+  auto other = truth;
+  other.rate = 3.0;
+  XCTAssertGreaterThan(matcher.loss(other), 0.01);
+}
+
+- (void)testRecoversKnownSettings {
+  PresetMatcher::Settings truth{2.5, 80.0, 70.0, 40.0, 60.0, 1.0, 0.3};
+  PresetMatcher matcher("PresetMatcherTests", format_, dry_, [self render:truth]);
+  auto result = matcher.match(8, 1500);
+  XCTAssertLessThan(result.loss, 1.0e-3);
+  XCTAssertEqualWithAccuracy(result.settings.rate, truth.rate, 0.01);
+  XCTAssertEqualWithAccuracy(result.settings.depth, truth.depth, 0.5);
+  XCTAssertEqualWithAccuracy(result.settings.intensity, truth.intensity, 0.5);
+  XCTAssertEqualWithAccuracy(result.settings.dryMix, truth.dryMix, 0.5);
+  XCTAssertEqualWithAccuracy(result.settings.wetMix, truth.wetMix, 0.5);
+  XCTAssertEqual(result.settings.odd90, truth.odd90);
+  XCTAssertEqualWithAccuracy(result.settings.lfoPhase, truth.lfoPhase, 0.005);
+  XCTAssertGreaterThan(result.evaluationCount, 8);
+}
+
+@end
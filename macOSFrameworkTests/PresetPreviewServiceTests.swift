@@ -0,0 +1,105 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+import AVFoundation
+import XCTest
+@testable import SimplyPhaserFramework
+
+class PresetPreviewServiceTests: XCTestCase {
+
+  private var directory: URL!
+  private var cacheDirectory: URL!
+  private var clip: URL!
+  private let preset = FilterPreset(rate: 2.0, depth: 80, intensity: 75, dryMix: 50, wetMix: 50, odd90: 1,
+                                    logSweep: 0, voices: 1, sync: 0, unlinked: 0, autoGain: 0)
+
+  override func setUpWithError() throws {
+    directory = FileManager.default.temporaryDirectory.appendingPathComponent(UUID().uuidString)
+    cacheDirectory = directory.appendingPathComponent("cache")
+    try FileManager.default.createDirectory(at: directory, withIntermediateDirectories: true)
+
+    // Half a second of stereo noise
+    clip = directory.appendingPathComponent("clip.wav")
+    let format = AVAudioFormat(standardFormatWithSampleRate: 44100.0, channels: 2)!
+    let buffer = AVAudioPCMBuffer(pcmFormat: format, frameCapacity: 22050)!
+    buffer.frameLength = buffer.frameCapacity
+    var seed: UInt32 = 1
+    for channel in 0..<Int(format.channelCount) {
+      for frame in 0..<Int(buffer.frameLength) {
+        seed = seed &* 1664525 &+ 1013904223
+        buffer.floatChannelData![channel][frame] = Float(seed >> 8) / Float(1 << 23) - 1.0
+      }
+    }
+    let file = try AVAudioFile(forWriting: clip, settings: format.settings, commonFormat: .pcmFormatFloat32,
+                               interleaved: false)
+    try file.write(from: buffer)
+  }
+
+  override func tearDownWithError() throws {
+    try FileManager.default.removeItem(at: directory)
+  }
+
+  private func render(_ service: PresetPreviewService, presets: [FilterPreset]) -> [[URL?]] {
+    let done = expectation(description: "rendered")
+    var previews = [[URL?]]()
+    service.renderPreviews(presets: presets, clips: [clip]) {
+      previews = $0
+      done.fulfill()
+    }
+    wait(for: [done], timeout: 60.0)
+    return previews
+  }
+
+  private func cacheContents() throws -> [String] {
+    try FileManager.default.contentsOfDirectory(atPath: cacheDirectory.path).sorted()
+  }
+
+  func testCacheMissThenHit() throws {
+    let service = PresetPreviewService(cacheDirectory: cacheDirectory, kernelVersion: "test")
+    XCTAssertNil(service.cachedPreview(for: preset, clip: clip))
+
+    let previews = render(service, presets: [preset])
+    let url = try XCTUnwrap(previews[0][0])
+    XCTAssertEqual(service.cachedPreview(for: preset, clip: clip), url)
+    XCTAssertGreaterThan(try AVAudioFile(forReading: url).length, 22050)
+
+    // A second render finds the preview in the cache and leaves the file alone.
+    let modified = try url.resourceValues(forKeys: [.contentModificationDateKey]).contentModificationDate
+    XCTAssertEqual(render(service, presets: [preset])[0][0], url)
+    XCTAssertEqual(try url.resourceValues(forKeys: [.contentModificationDateKey]).contentModificationDate, modified)
+
+    // So does another service using the same cache and kernel version, but not one with another kernel version.
+    XCTAssertEqual(PresetPreviewService(cacheDirectory: cacheDirectory, kernelVersion: "test")
+                    .cachedPreview(for: preset, clip: clip), url)
+    XCTAssertNil(PresetPreviewService(cacheDirectory: cacheDirectory, kernelVersion: "other")
+                  .cachedPreview(for: preset, clip: clip))
+  }
+
+  func testParameterChangeMakesNewKey() throws {
+    let service = PresetPreviewService(cacheDirectory: cacheDirectory, kernelVersion: "test")
+    let changed = FilterPreset(rate: 2.0, depth: 80, intensity: 75, dryMix: 50, wetMix: 50, odd90: 1,
+                               logSweep: 0, voices: 1, sync: 0, unlinked: 0, autoGain: 1)
+    let first = try XCTUnwrap(render(service, presets: [preset])[0][0])
+    XCTAssertNil(service.cachedPreview(for: changed, clip: clip))
+
+    let second = try XCTUnwrap(render(service, presets: [changed])[0][0])
+    XCTAssertNotEqual(first, second)
+    XCTAssertEqual(service.cachedPreview(for: preset, clip: clip), first)
+    XCTAssertEqual(service.cachedPreview(for: changed, clip: clip), second)
+    XCTAssertEqual(try cacheContents().count, 2)
+  }
+
+  func testConcurrentRendersReplaceTemporaryFiles() throws {
+    // Every render of the same preview writes its own temporary file and renames it to the same final name. Only the
+    // complete preview may remain afterwards.
+    let service = PresetPreviewService(cacheDirectory: cacheDirectory, kernelVersion: "test")
+    let previews = render(service, presets: Array(repeating: preset, count: 8))
+    let url = try XCTUnwrap(previews[0][0])
+    XCTAssertTrue(previews.allSatisfy { $0 == [url] })
+    XCTAssertEqual(try cacheContents(), [url.lastPathComponent])
+
+    // The preview is the same as one rendered on its own.
+    let other = PresetPreviewService(cacheDirectory: directory.appendingPathComponent("other"), kernelVersion: "test")
+    let single = try XCTUnwrap(render(other, presets: [preset])[0][0])
+    XCTAssertEqual(try Data(contentsOf: url), try Data(contentsOf: single))
+  }
+}
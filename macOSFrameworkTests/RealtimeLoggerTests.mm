@@ -0,0 +1,85 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#import <XCTest/XCTest.h>
+#import <mutex>
+#import <string>
+#import <thread>
+#import <vector>
+
+#import "RealtimeLogger.hpp"
+
+@interface RealtimeLoggerTests : XCTestCase
+@end
+
+@implementation RealtimeLoggerTests {
+  std::mutex mutex_;
+  std::vector<std::string> messages_;
+}
+
+- (RealtimeLogger::Sink)sink {
+  return [self](const char* message) {
+    std::lock_guard<std::mutex> guard(self->mutex_);
+    self->messages_.emplace_back(message);
+  };
+}
+
+- (size_t)messageCount {
+  std::lock_guard<std::mutex> guard(mutex_);
+  return messages_.size();
+}
+
+- (void)setUp {
+  messages_.clear();
+}
+
+- (void)testFormatting {
+  RealtimeLogger logger({"none", "one - %.1f", "two - %.0f %.2f", "four - %.0f %.0f %.0f %.0f"}, [self sink]);
+  XCTAssertTrue(logger.log(0));
+  XCTAssertTrue(logger.log(1, 1.5f));
+  XCTAssertTrue(logger.log(2, true, 3.14159));
+  XCTAssertTrue(logger.log(3, 1, 2, 3, 4));
+  logger.flush();
+  XCTAssertEqual([self messageCount], 4);
+  XCTAssertTrue(messages_[0] == "none");
+  XCTAssertTrue(messages_[1] == "one - 1.5");
+  XCTAssertTrue(messages_[2] == "two - 1 3.14");
+  XCTAssertTrue(messages_[3] == "four - 1 2 3 4");
+  XCTAssertEqual(logger.droppedCount(), 0);
+}
+
+- (void)testUnknownFormatIsIgnored {
+  RealtimeLogger logger({"one - %.1f"}, [self sink]);
+  XCTAssertTrue(logger.log(1, 1.0));
+  logger.flush();
+  XCTAssertEqual([self messageCount], 0);
+}
+
+- (void)testOverflowIsCounted {
+  RealtimeLogger logger({"value - %.0f"}, [self sink]);
+  const int total = 100 * RealtimeLogger::capacity;
+  int accepted = 0;
+  for (int counter = 0; counter < total; ++counter) {
+    if (logger.log(0, counter)) ++accepted;
+  }
+  logger.flush();
+  XCTAssertEqual([self messageCount], accepted);
+  XCTAssertEqual(accepted + logger.droppedCount(), total);
+}
+
+- (void)testMultipleProducers {
+  RealtimeLogger logger({"value - %.0f"}, [self sink]);
+  const int perThread = 10000;
+  std::vector<std::thread> threads;
+  for (int index = 0; index < 4; ++index) {
+    threads.emplace_back([&logger] {
+      for (int counter = 0; counter < perThread; ++counter) {
+        logger.log(0, counter);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  logger.flush();
+  XCTAssertEqual([self messageCount] + logger.droppedCount(), 4 * perThread);
+}
+
+@end
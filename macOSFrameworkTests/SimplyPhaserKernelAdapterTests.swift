@@ -0,0 +1,65 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+import AVFoundation
+import XCTest
+@testable import SimplyPhaserFramework
+
+class SimplyPhaserKernelAdapterTests: XCTestCase {
+
+  private let float32 = AVAudioFormat(commonFormat: .pcmFormatFloat32, sampleRate: 44100.0, channels: 2,
+                                      interleaved: false)!
+  private let float64 = AVAudioFormat(commonFormat: .pcmFormatFloat64, sampleRate: 44100.0, channels: 2,
+                                      interleaved: false)!
+  private let mono = AVAudioFormat(commonFormat: .pcmFormatFloat32, sampleRate: 44100.0, channels: 1,
+                                   interleaved: false)!
+
+  private func makeBuffer(_ format: AVAudioFormat, frameLength: AVAudioFrameCount = 1024) -> AVAudioPCMBuffer {
+    let buffer = AVAudioPCMBuffer(pcmFormat: format, frameCapacity: 4096)!
+    buffer.frameLength = frameLength
+    return buffer
+  }
+
+  private func makeKernel(_ format: AVAudioFormat) -> SimplyPhaserKernelAdapter {
+    let kernel = SimplyPhaserKernelAdapter("SimplyPhaserKernelAdapterTests")
+    kernel.parameterLogging = false
+    kernel.startProcessing(format, maxFramesToRender: 512)
+    return kernel
+  }
+
+  func testRendersMatchingFormats() {
+    for format in [float32, float64] {
+      let kernel = makeKernel(format)
+      XCTAssertGreaterThanOrEqual(kernel.renderClip(makeBuffer(format), output: makeBuffer(format, frameLength: 0),
+                                                    tailThreshold: 1.0e-4), 1024)
+      let output = makeBuffer(format, frameLength: 0)
+      XCTAssertTrue(kernel.renderStream(makeBuffer(format), output: output))
+      XCTAssertEqual(output.frameLength, 1024)
+    }
+  }
+
+  func testRejectsMismatchedSampleFormats() {
+    let kernel = makeKernel(float32)
+    let output = makeBuffer(float64, frameLength: 0)
+    XCTAssertEqual(kernel.renderClip(makeBuffer(float32), output: output, tailThreshold: 1.0e-4), 0)
+    XCTAssertEqual(output.frameLength, 0)
+    XCTAssertFalse(kernel.renderStream(makeBuffer(float32), output: output))
+    XCTAssertFalse(kernel.renderStream(makeBuffer(float64), output: makeBuffer(float32)))
+    XCTAssertTrue(kernel.renderTail(output, tailThreshold: 1.0e-4))
+    XCTAssertEqual(output.frameLength, 0)
+  }
+
+  func testRejectsMismatchedChannelCounts() {
+    let kernel = makeKernel(float32)
+    let output = makeBuffer(mono, frameLength: 0)
+    XCTAssertEqual(kernel.renderClip(makeBuffer(float32), output: output, tailThreshold: 1.0e-4), 0)
+    XCTAssertFalse(kernel.renderStream(makeBuffer(mono), output: makeBuffer(float32)))
+    XCTAssertTrue(kernel.renderTail(output, tailThreshold: 1.0e-4))
+    XCTAssertEqual(output.frameLength, 0)
+  }
+
+  func testRejectsRenderingWhenStopped() {
+    let kernel = makeKernel(float32)
+    kernel.stopProcessing()
+    XCTAssertFalse(kernel.renderStream(makeBuffer(float32), output: makeBuffer(float32)))
+  }
+}
@@ -0,0 +1,515 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#import <XCTest/XCTest.h>
+#import <algorithm>
+#import <array>
+#import <cmath>
+#import <memory>
+#import <utility>
+#import <vector>
+
+#import "ClipBatchRenderer.h"
+#import "SimplyPhaserKernel.h"
+
+using Settings = std::vector<std::pair<AUParameterAddress, AUValue>>;
+
+/// Parameter settings for the tests, with a sweep that moves all of the filters.
+static const Settings parameters = {
+  {FilterParameterAddressRate, 2.0},
+  {FilterParameterAddressDepth, 100.0},
+  {FilterParameterAddressIntensity, 90.0},
+  {FilterParameterAddressDryMix, 50.0},
+  {FilterParameterAddressWetMix, 50.0},
+  {FilterParameterAddressOdd90, 0.0},
+  {FilterParameterAddressRightDepth, 100.0},
+  {FilterParameterAddressRightIntensity, 90.0},
+  {FilterParameterAddressRightDryMix, 50.0},
+  {FilterParameterAddressRightWetMix, 50.0}
+};
+
+/**
+ Create a stereo test signal with different content in each channel.
+ */
+static std::vector<std::vector<AUValue>> makeInput(size_t frameCount) {
+  std::vector<std::vector<AUValue>> input(2, std::vector<AUValue>(frameCount));
+  uint32_t seed = 1;
+  for (size_t frame = 0; frame < frameCount; ++frame) {
+    seed = seed * 1664525u + 1013904223u;
+    input[0][frame] = std::sin(frame / 10.0);
+    input[1][frame] = seed / 4294967296.0 - 0.5;
+  }
+  return input;
+}
+
+template <typename T, typename Sample>
+static std::vector<T*> pointers(std::vector<std::vector<Sample>>& buffers, size_t offset = 0) {
+  std::vector<T*> result;
+  for (auto& buffer : buffers) result.push_back(buffer.data() + offset);
+  return result;
+}
+
+/**
+ Obtain the mean-square power over all channels of the last second of a stream.
+ */
+static double lastSecondPower(const std::vector<std::vector<AUValue>>& buffers) {
+  std::vector<AUValue const*> channels;
+  for (auto const& buffer : buffers) channels.push_back(buffer.data() + buffer.size() - 44100);
+  return AutoGain<double>::meanSquare(channels, 44100);
+}
+
+@interface SimplyPhaserKernelTests : XCTestCase
+@end
+
+@implementation SimplyPhaserKernelTests {
+  AVAudioFormat* format_;
+  AVAudioPCMBuffer* output_;
+  AURenderPullInputBlock pullInput_;
+}
+
+- (void)setUp {
+  format_ = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:44100.0 channels:2];
+  output_ = [[AVAudioPCMBuffer alloc] initWithPCMFormat:format_ frameCapacity:512];
+  output_.frameLength = 512;
+  pullInput_ = ^AUAudioUnitStatus(AudioUnitRenderActionFlags* actionFlags, const AudioTimeStamp* timestamp,
+                                  AUAudioFrameCount frameCount, NSInteger inputBusNumber, AudioBufferList* input) {
+    for (UInt32 channel = 0; channel < input->mNumberBuffers; ++channel) {
+      auto samples = static_cast<AUValue*>(input->mBuffers[channel].mData);
+      for (AUAudioFrameCount frame = 0; frame < frameCount; ++frame) samples[frame] = std::sin(frame / 10.0);
+    }
+    return noErr;
+  };
+}
+
+/**
+ Create a kernel that is ready to render, with the test parameter settings.
+ */
+- (std::unique_ptr<SimplyPhaserKernel>)makeKernel:(AVAudioFormat*)format {
+  auto kernel = std::make_unique<SimplyPhaserKernel>("SimplyPhaserKernelTests");
+  for (auto [address, value] : parameters) kernel->setParameterValue(address, value);
+  kernel->startProcessing(format, 512);
+  return kernel;
+}
+
+- (std::unique_ptr<SimplyPhaserKernel>)makeKernel { return [self makeKernel:format_]; }
+
+/**
+ Render one buffer through a kernel the way a host does.
+ */
+- (void)render:(SimplyPhaserKernel&)kernel frameCount:(AUAudioFrameCount)frameCount {
+  AudioTimeStamp timestamp{};
+  auto status = kernel.processAndRender(&timestamp, frameCount, 0, output_.mutableAudioBufferList, nullptr,
+                                        pullInput_);
+  XCTAssertEqual(status, noErr);
+}
+
+- (void)testResetRendersSameSamples {
+  auto kernel = [self makeKernel];
+  auto input = makeInput(44100);
+  std::vector<std::vector<AUValue>> first(2, std::vector<AUValue>(44100));
+  std::vector<std::vector<AUValue>> second(2, std::vector<AUValue>(44100));
+  kernel->renderStream(pointers<AUValue const>(input), pointers<AUValue>(first), 44100);
+  kernel->reset();
+  kernel->renderStream(pointers<AUValue const>(input), pointers<AUValue>(second), 44100);
+  XCTAssertTrue(first == second);
+}
+
+- (void)testTailEndsBelowThreshold {
+  auto kernel = [self makeKernel];
+  size_t frameCount = 4410;
+  size_t maxTailFrames = 441000;
+  AUValue tailThreshold = 1.0e-4;
+  auto input = makeInput(frameCount);
+  std::vector<std::vector<AUValue>> output(2, std::vector<AUValue>(frameCount + maxTailFrames));
+  auto rendered = kernel->renderClip(pointers<AUValue const>(input), pointers<AUValue>(output), frameCount,
+                                     maxTailFrames, tailThreshold);
+  XCTAssertGreaterThan(rendered, frameCount);
+  XCTAssertLessThan(rendered, frameCount + maxTailFrames);
+  XCTAssertEqual((rendered - frameCount) % 512, 0);
+
+  // The last tail block is below the threshold and the one before it is not.
+  auto peak = [&output](size_t begin, size_t end) {
+    AUValue peak = 0.0;
+    for (auto const& channel : output) {
+      for (size_t frame = begin; frame < end; ++frame) peak = std::max(peak, std::abs(channel[frame]));
+    }
+    return peak;
+  };
+  XCTAssertLessThan(peak(rendered - 512, rendered), tailThreshold);
+  if (rendered - frameCount > 512) {
+    XCTAssertGreaterThanOrEqual(peak(rendered - 1024, rendered - 512), tailThreshold);
+  }
+
+  // Nothing is left to render after the tail.
+  std::vector<std::vector<AUValue>> tail(2, std::vector<AUValue>(512));
+  bool done = false;
+  XCTAssertEqual(kernel->renderTail(pointers<AUValue>(tail), 512, tailThreshold, done), 512);
+  XCTAssertTrue(done);
+}
+
+- (void)testTailIsCappedAtMaxTailFrames {
+  // A threshold of zero is never reached, so the tail runs until the cap, which ends inside a block.
+  auto kernel = [self makeKernel];
+  size_t frameCount = 4410;
+  size_t maxTailFrames = 1000;
+  auto input = makeInput(frameCount);
+  std::vector<std::vector<AUValue>> output(2, std::vector<AUValue>(frameCount + maxTailFrames));
+  XCTAssertEqual(kernel->renderClip(pointers<AUValue const>(input), pointers<AUValue>(output), frameCount,
+                                    maxTailFrames, 0.0), frameCount + maxTailFrames);
+
+  std::vector<std::vector<AUValue>> tail(2, std::vector<AUValue>(maxTailFrames));
+  bool done = true;
+  XCTAssertEqual(kernel->renderTail(pointers<AUValue>(tail), maxTailFrames, 0.0, done), maxTailFrames);
+  XCTAssertFalse(done);
+}
+
+- (void)testStreamPiecesMatchOneShot {
+  size_t frameCount = 44100;
+  auto input = makeInput(frameCount);
+  std::vector<std::vector<AUValue>> oneShot(2, std::vector<AUValue>(frameCount));
+  std::vector<std::vector<AUValue>> pieces(2, std::vector<AUValue>(frameCount));
+
+  auto kernel = [self makeKernel];
+  kernel->renderStream(pointers<AUValue const>(input), pointers<AUValue>(oneShot), frameCount);
+
+  // Every piece but the last is a multiple of 512 frames.
+  kernel->reset();
+  size_t position = 0;
+  for (size_t size : {512, 4096, 1536, 16384}) {
+    kernel->renderStream(pointers<AUValue const>(input, position), pointers<AUValue>(pieces, position), size);
+    position += size;
+  }
+  kernel->renderStream(pointers<AUValue const>(input, position), pointers<AUValue>(pieces, position),
+                       frameCount - position);
+  XCTAssertTrue(oneShot == pieces);
+}
+
+- (void)testSwitchingVoicesMidStream {
+  // Go from one voice to four and back while rendering, the way a preset change does during playback.
+  size_t segmentFrames = 8 * 512;
+  size_t frameCount = 3 * segmentFrames;
+  auto input = makeInput(frameCount);
+  std::vector<std::vector<AUValue>> switched(2, std::vector<AUValue>(frameCount));
+  std::vector<std::vector<AUValue>> single(2, std::vector<AUValue>(frameCount));
+
+  auto kernel = [self makeKernel];
+  auto reference = [self makeKernel];
+  for (size_t position = 0; position < frameCount; position += 512) {
+    if (position == segmentFrames) kernel->setParameterValue(FilterParameterAddressVoices, 4);
+    if (position == 2 * segmentFrames) kernel->setParameterValue(FilterParameterAddressVoices, 1);
+    kernel->renderStream(pointers<AUValue const>(input, position), pointers<AUValue>(switched, position), 512);
+    reference->renderStream(pointers<AUValue const>(input, position), pointers<AUValue>(single, position), 512);
+  }
+
+  std::array<double, 3> differences{0.0, 0.0, 0.0};
+  for (size_t channel = 0; channel < 2; ++channel) {
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+      XCTAssertTrue(std::isfinite(switched[channel][frame]));
+      XCTAssertLessThan(std::abs(switched[channel][frame]), 4.0);
+      auto& difference = differences[frame / segmentFrames];
+      difference = std::max(difference, double(std::abs(switched[channel][frame] - single[channel][frame])));
+    }
+  }
+  XCTAssertEqual(differences[0], 0.0);
+  XCTAssertGreaterThan(differences[1], 0.01);
+}
+
+/**
+ Render a stream with auto gain on and only the wet signal in the mix.
+ */
+- (std::vector<std::vector<AUValue>>)renderWithAutoGain:(std::vector<std::vector<AUValue>>&)input {
+  auto kernel = [self makeKernel];
+  kernel->setParameterValue(FilterParameterAddressDryMix, 0.0);
+  kernel->setParameterValue(FilterParameterAddressWetMix, 100.0);
+  kernel->setParameterValue(FilterParameterAddressRightDryMix, 0.0);
+  kernel->setParameterValue(FilterParameterAddressRightWetMix, 100.0);
+  kernel->setParameterValue(FilterParameterAddressAutoGain, 1.0);
+  std::vector<std::vector<AUValue>> output(input.size(), std::vector<AUValue>(input[0].size()));
+  kernel->renderStream(pointers<AUValue const>(input), pointers<AUValue>(output), input[0].size());
+  return output;
+}
+
+- (void)testAutoGainMatchesInputLevel {
+  auto input = makeInput(4 * 44100);
+  auto output = [self renderWithAutoGain:input];
+  XCTAssertEqualWithAccuracy(10.0 * std::log10(lastSecondPower(output) / lastSecondPower(input)), 0.0, 0.5);
+}
+
+- (void)testAutoGainIgnoresNaNInput {
+  // The NaN sample resets one channel, but it must not get into the gain that is applied to all of them.
+  auto input = makeInput(4 * 44100);
+  input[0][10 * 512 + 7] = NAN;
+  auto output = [self renderWithAutoGain:input];
+  size_t nonFiniteCount = 0;
+  for (auto const& channel : output) {
+    nonFiniteCount += std::count_if(channel.begin(), channel.end(), [](auto sample) { return !std::isfinite(sample); });
+  }
+  XCTAssertEqual(nonFiniteCount, 0);
+  XCTAssertEqualWithAccuracy(10.0 * std::log10(lastSecondPower(output) / lastSecondPower(input)), 0.0, 0.5);
+}
+
+- (void)testNaNInputSilencesOnlyItsChannelBlock {
+  // A NaN in one channel resets that channel's filters and silences its block. The other channel must not notice.
+  size_t frameCount = 44100;
+  size_t block = 10;
+  auto input = makeInput(frameCount);
+  std::vector<std::vector<AUValue>> clean(2, std::vector<AUValue>(frameCount));
+  std::vector<std::vector<AUValue>> output(2, std::vector<AUValue>(frameCount));
+  [self makeKernel]->renderStream(pointers<AUValue const>(input), pointers<AUValue>(clean), frameCount);
+
+  input[0][block * 512 + 7] = NAN;
+  auto kernel = [self makeKernel];
+  auto resetCount = kernel->nonFiniteResetCount();
+  kernel->renderStream(pointers<AUValue const>(input), pointers<AUValue>(output), frameCount);
+  XCTAssertEqual(kernel->nonFiniteResetCount(), resetCount + 1);
+
+  auto blockBegin = output[0].begin() + block * 512;
+  auto blockEnd = blockBegin + 512;
+  XCTAssertTrue(std::equal(output[0].begin(), blockBegin, clean[0].begin()));
+  XCTAssertTrue(std::all_of(blockBegin, blockEnd, [](auto sample) { return sample == 0.0; }));
+  XCTAssertTrue(std::all_of(blockEnd, output[0].end(), [](auto sample) { return std::isfinite(sample); }));
+  XCTAssertTrue(std::any_of(blockEnd, output[0].end(), [](auto sample) { return sample != 0.0; }));
+  XCTAssertTrue(output[1] == clean[1]);
+}
+
+- (void)testStoppedTransportLetsSyncedLFOsRun {
+  // A stopped host reports the same beat position for every render. The synced LFOs must keep running at the rate of
+  // the tempo instead of going back to that position every block, which makes them match a host playing from there.
+  size_t frameCount = 100 * 512;
+  auto input = makeInput(frameCount);
+  std::vector<std::vector<AUValue>> stopped(2, std::vector<AUValue>(frameCount));
+  std::vector<std::vector<AUValue>> playing(2, std::vector<AUValue>(frameCount));
+
+  auto stoppedKernel = [self makeKernel];
+  auto playingKernel = [self makeKernel];
+  stoppedKernel->setParameterValue(FilterParameterAddressSync, 5);
+  playingKernel->setParameterValue(FilterParameterAddressSync, 5);
+  for (size_t position = 0; position < frameCount; position += 512) {
+    stoppedKernel->setMusicalContext(MusicalContext{120.0, 0.0, false});
+    stoppedKernel->renderStream(pointers<AUValue const>(input, position), pointers<AUValue>(stopped, position), 512);
+    playingKernel->setMusicalContext(MusicalContext{120.0, position * 120.0 / (60.0 * 44100.0), true});
+    playingKernel->renderStream(pointers<AUValue const>(input, position), pointers<AUValue>(playing, position), 512);
+  }
+
+  for (size_t channel = 0; channel < 2; ++channel) {
+    for (size_t frame = 0; frame < frameCount; ++frame) {
+      XCTAssertEqualWithAccuracy(stopped[channel][frame], playing[channel][frame], 1.0e-5);
+    }
+  }
+}
+
+- (void)testClipBatchMatchesSerial {
+  size_t maxTailFrames = 22050;
+  AUValue tailThreshold = 1.0e-4;
+  std::vector<size_t> frameCounts = {4410, 1000, 512, 22050, 3, 8000, 4410, 12345};
+  auto input = makeInput(*std::max_element(frameCounts.begin(), frameCounts.end()));
+
+  std::vector<std::vector<std::vector<AUValue>>> batchOutputs;
+  std::vector<ClipBatchRenderer::Clip> clips;
+  for (auto frameCount : frameCounts) {
+    batchOutputs.emplace_back(2, std::vector<AUValue>(frameCount + maxTailFrames));
+    clips.push_back({pointers<AUValue const>(input), pointers<AUValue>(batchOutputs.back()), frameCount});
+  }
+
+  ClipBatchRenderer renderer("SimplyPhaserKernelTests", format_, 4);
+  for (auto [address, value] : parameters) renderer.setParameterValue(address, value);
+  renderer.render(clips, maxTailFrames, tailThreshold);
+
+  auto kernel = [self makeKernel];
+  for (size_t index = 0; index < clips.size(); ++index) {
+    std::vector<std::vector<AUValue>> output(2, std::vector<AUValue>(frameCounts[index] + maxTailFrames));
+    auto rendered = kernel->renderClip(pointers<AUValue const>(input), pointers<AUValue>(output),
+                                       frameCounts[index], maxTailFrames, tailThreshold);
+    XCTAssertEqual(clips[index].renderedFrameCount, rendered);
+    XCTAssertTrue(batchOutputs[index] == output);
+  }
+}
+
+- (void)testDoubleClipMatchesFloatClip {
+  // Processing is done in double precision for both sample types, so they only differ by float rounding.
+  size_t frameCount = 44100;
+  size_t maxTailFrames = 44100;
+  AUValue tailThreshold = 1.0e-4;
+  auto floatInput = makeInput(frameCount);
+  std::vector<std::vector<double>> doubleInput;
+  for (auto const& channel : floatInput) doubleInput.emplace_back(channel.begin(), channel.end());
+  std::vector<std::vector<AUValue>> floatOutput(2, std::vector<AUValue>(frameCount + maxTailFrames));
+  std::vector<std::vector<double>> doubleOutput(2, std::vector<double>(frameCount + maxTailFrames));
+
+  auto kernel = [self makeKernel];
+  auto floatRendered = kernel->renderClip(pointers<AUValue const>(floatInput), pointers<AUValue>(floatOutput),
+                                          frameCount, maxTailFrames, tailThreshold);
+  auto doubleRendered = kernel->renderClip(pointers<double const>(doubleInput), pointers<double>(doubleOutput),
+                                           frameCount, maxTailFrames, tailThreshold);
+  XCTAssertEqual(floatRendered, doubleRendered);
+  for (size_t channel = 0; channel < 2; ++channel) {
+    for (size_t frame = 0; frame < floatRendered; ++frame) {
+      XCTAssertEqualWithAccuracy(floatOutput[channel][frame], doubleOutput[channel][frame], 1.0e-6);
+    }
+  }
+}
+
+- (void)testDoubleBusMatchesFloatBus {
+  // The same signal pulled through a float32 bus and a float64 bus, the way a host renders.
+  AVAudioFormat* doubleFormat = [[AVAudioFormat alloc] initWithCommonFormat:AVAudioPCMFormatFloat64 sampleRate:44100.0
+                                                                    channels:2 interleaved:NO];
+  AVAudioPCMBuffer* doubleOutput = [[AVAudioPCMBuffer alloc] initWithPCMFormat:doubleFormat frameCapacity:512];
+  doubleOutput.frameLength = 512;
+  AURenderPullInputBlock doublePullInput = ^AUAudioUnitStatus(AudioUnitRenderActionFlags* actionFlags,
+                                                              const AudioTimeStamp* timestamp,
+                                                              AUAudioFrameCount frameCount, NSInteger inputBusNumber,
+                                                              AudioBufferList* input) {
+    for (UInt32 channel = 0; channel < input->mNumberBuffers; ++channel) {
+      auto samples = static_cast<double*>(input->mBuffers[channel].mData);
+      for (AUAudioFrameCount frame = 0; frame < frameCount; ++frame) samples[frame] = AUValue(std::sin(frame / 10.0));
+    }
+    return noErr;
+  };
+
+  auto floatKernel = [self makeKernel];
+  auto doubleKernel = [self makeKernel:doubleFormat];
+  for (int buffer = 0; buffer < 100; ++buffer) {
+    AudioTimeStamp timestamp{};
+    [self render:*floatKernel frameCount:512];
+    XCTAssertEqual(doubleKernel->processAndRender(&timestamp, 512, 0, doubleOutput.mutableAudioBufferList, nullptr,
+                                                  doublePullInput), noErr);
+    for (UInt32 channel = 0; channel < 2; ++channel) {
+      auto floatSamples = output_.floatChannelData[channel];
+      auto doubleSamples = static_cast<double const*>(doubleOutput.audioBufferList->mBuffers[channel].mData);
+      for (size_t frame = 0; frame < 512; ++frame) {
+        XCTAssertEqualWithAccuracy(floatSamples[frame], doubleSamples[frame], 1.0e-6);
+      }
+    }
+  }
+}
+
+- (void)testMirroredOutputMatchesRendering {
+  // The channels start out identical, then differ, then fall silent, then are identical again. The silence lets the
+  // filter state of the second channel become identical to that of the first one again, so mirroring starts twice and
+  // stops once. Each channel must match a mono kernel that renders it on its own.
+  size_t segment = 44100;
+  auto noise = makeInput(segment * 2)[1];
+  std::vector<std::vector<AUValue>> input(2, std::vector<AUValue>(segment * 8, 0.0));
+  for (size_t frame = 0; frame < segment; ++frame) {
+    input[0][frame] = input[1][frame] = noise[frame];
+    input[0][frame + segment] = noise[frame];
+    input[1][frame + segment] = noise[frame + segment];
+    input[0][frame + segment * 7] = input[1][frame + segment * 7] = noise[frame + segment];
+  }
+
+  auto stereo = [self makeKernel];
+  std::vector<std::vector<AUValue>> output(2, std::vector<AUValue>(input[0].size()));
+  std::vector<size_t> mirroredBlocks(8, 0);
+  for (size_t position = 0; position < input[0].size(); position += 512) {
+    auto count = std::min<size_t>(512, input[0].size() - position);
+    stereo->renderStream(pointers<AUValue const>(input, position), pointers<AUValue>(output, position), count);
+    mirroredBlocks[position / segment] += stereo->mirroredChannelCount();
+  }
+  XCTAssertGreaterThan(mirroredBlocks[0], 0);
+  XCTAssertEqual(mirroredBlocks[1], 0);
+  XCTAssertGreaterThan(mirroredBlocks[7], 0);
+
+  AVAudioFormat* mono = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:44100.0 channels:1];
+  for (size_t channel = 0; channel < 2; ++channel) {
+    auto kernel = [self makeKernel:mono];
+    std::vector<AUValue> expected(input[channel].size());
+    kernel->renderStream(std::vector<AUValue const*>{input[channel].data()}, std::vector<AUValue*>{expected.data()},
+                         expected.size());
+    XCTAssertTrue(output[channel] == expected);
+  }
+}
+
+/**
+ Render a stream with a kernel made by `makeKernel:` and then given more settings.
+ */
+- (std::vector<std::vector<AUValue>>)renderStream:(std::vector<std::vector<AUValue>>&)input
+                                           format:(AVAudioFormat*)format
+                                         settings:(const Settings&)settings {
+  auto kernel = [self makeKernel:format];
+  for (auto [address, value] : settings) kernel->setParameterValue(address, value);
+  std::vector<std::vector<AUValue>> output(input.size(), std::vector<AUValue>(input[0].size()));
+  kernel->renderStream(pointers<AUValue const>(input), pointers<AUValue>(output), input[0].size());
+  return output;
+}
+
+/**
+ Render one channel of the input on its own with a mono kernel.
+ */
+- (std::vector<AUValue>)renderChannel:(std::vector<AUValue>&)input settings:(const Settings&)settings {
+  AVAudioFormat* mono = [[AVAudioFormat alloc] initStandardFormatWithSampleRate:44100.0 channels:1];
+  std::vector<std::vector<AUValue>> channel(1, input);
+  return [self renderStream:channel format:mono settings:settings][0];
+}
+
+- (void)testUnlinkedOddChannelUsesRightSettings {
+  // The odd channel follows the right LFO, depth and mix. The even channel is not affected.
+  auto input = makeInput(44100);
+  auto linked = [self renderStream:input format:format_ settings:Settings()];
+  auto unlinked = [self renderStream:input format:format_ settings:Settings{
+    {FilterParameterAddressUnlinked, 1.0},
+    {FilterParameterAddressRightRate, 0.5},
+    {FilterParameterAddressRightDepth, 40.0},
+    {FilterParameterAddressRightDryMix, 30.0},
+    {FilterParameterAddressRightWetMix, 70.0}
+  }];
+  XCTAssertTrue(unlinked[0] == linked[0]);
+  XCTAssertTrue(unlinked[1] != linked[1]);
+  auto expected = [self renderChannel:input[1] settings:Settings{
+    {FilterParameterAddressRate, 0.5},
+    {FilterParameterAddressDepth, 40.0},
+    {FilterParameterAddressDryMix, 30.0},
+    {FilterParameterAddressWetMix, 70.0}
+  }];
+  XCTAssertTrue(unlinked[1] == expected);
+}
+
+- (void)testUnlinkedOddChannelUsesRightIntensity {
+  // The intensity of the odd channel's filters changes when the kernel is already running.
+  auto input = makeInput(44100);
+  auto linked = [self renderStream:input format:format_ settings:Settings()];
+  auto unlinked = [self renderStream:input format:format_ settings:Settings{
+    {FilterParameterAddressUnlinked, 1.0},
+    {FilterParameterAddressRightRate, 2.0},
+    {FilterParameterAddressRightIntensity, 40.0}
+  }];
+  XCTAssertTrue(unlinked[0] == linked[0]);
+  XCTAssertTrue(unlinked[1] != linked[1]);
+  auto expected = [self renderChannel:input[1] settings:Settings{{FilterParameterAddressIntensity, 40.0}}];
+  XCTAssertTrue(unlinked[1] == expected);
+}
+
+- (void)testUnlinkedMatchesLinkedWithSameSettings {
+  // A new kernel starts with the same settings on both sides.
+  SimplyPhaserKernel kernel("SimplyPhaserKernelTests");
+  XCTAssertEqual(kernel.getParameterValue(FilterParameterAddressRightRate),
+                 kernel.getParameterValue(FilterParameterAddressRate));
+  XCTAssertEqual(kernel.getParameterValue(FilterParameterAddressRightDepth),
+                 kernel.getParameterValue(FilterParameterAddressDepth));
+  XCTAssertEqual(kernel.getParameterValue(FilterParameterAddressRightIntensity),
+                 kernel.getParameterValue(FilterParameterAddressIntensity));
+  XCTAssertEqual(kernel.getParameterValue(FilterParameterAddressRightDryMix),
+                 kernel.getParameterValue(FilterParameterAddressDryMix));
+  XCTAssertEqual(kernel.getParameterValue(FilterParameterAddressRightWetMix),
+                 kernel.getParameterValue(FilterParameterAddressWetMix));
+
+  auto input = makeInput(44100);
+  auto linked = [self renderStream:input format:format_ settings:Settings()];
+  auto unlinked = [self renderStream:input format:format_ settings:Settings{
+    {FilterParameterAddressUnlinked, 1.0},
+    {FilterParameterAddressRightRate, 2.0}
+  }];
+  XCTAssertTrue(unlinked == linked);
+}
+
+- (void)testColdStartPerformance {
+  // Time from construction of 100 stereo kernels, including their parameter settings, to their first rendered buffer.
+  [self measureBlock:^{
+    std::vector<std::unique_ptr<SimplyPhaserKernel>> kernels;
+    kernels.reserve(100);
+    for (int instance = 0; instance < 100; ++instance) {
+      kernels.emplace_back([self makeKernel]);
+      [self render:*kernels.back() frameCount:512];
+    }
+  }];
+}
+
+@end
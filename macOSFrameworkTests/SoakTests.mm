@@ -0,0 +1,96 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#import <XCTest/XCTest.h>
+#import <chrono>
+#import <cmath>
+#import <cstdlib>
+
+#import "LFO.h"
+#import "PhaseShifter.h"
+
+/**
+ Accelerated soak test that renders long stretches of audio offline through one long-lived LFO + PhaseShifter pair,
+ cycling through every combination of rate, depth and intensity. Each segment renders a burst of noise followed by a
+ long silence, so that the filter state decays towards zero where subnormal values would show up. The filter state is
+ checked for subnormal and runaway values throughout, and the LFO phase is compared with an exact accumulation after
+ each pass.
+
+ By default a short pass of a few simulated minutes runs with the unit tests. Set the SOAK_HOURS environment variable
+ to run that many simulated hours instead, each of which covers all combinations.
+ */
+@interface SoakTests : XCTestCase
+@end
+
+@implementation SoakTests
+
+- (void)testSoak {
+  double sampleRate = 44100.0;
+  const double rates[] = {0.02, 1.0, 20.0};
+  const double depths[] = {0.0, 0.5, 1.0};
+  const double intensities[] = {0.0, 0.9};
+  const int combinations = 3 * 3 * 2;
+
+  int passes = 1;
+  double secondsPerPass = combinations * 12.0;
+  if (auto env = std::getenv("SOAK_HOURS")) {
+    passes = std::max(1, std::atoi(env));
+    secondsPerPass = 3600.0;
+  }
+
+  const int samplesPerSegment = int(sampleRate * secondsPerPass / combinations);
+  const int samplesPerCheck = 64;
+
+  LFO<double> lfo(sampleRate, rates[0], LFOWaveform::triangle);
+  PhaseShifter<double> phaseShifter{PhaseShifter<double>::ideal, sampleRate, intensities[0], 20};
+
+  long double expectedPhase = 0.0;
+  uint32_t seed = 1;
+
+  for (int pass = 0; pass < passes; ++pass) {
+    double maxMagnitude = 0.0;
+    int subnormalChecks = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int segment = 0; segment < combinations; ++segment) {
+      double rate = rates[segment % 3];
+      double depth = depths[(segment / 3) % 3];
+      double intensity = intensities[(segment / 9) % 2];
+      lfo.setFrequency(rate);
+      phaseShifter.setIntensity(intensity);
+
+      for (int counter = 0; counter < samplesPerSegment; ++counter) {
+        double input = 0.0;
+        if (counter < samplesPerSegment / 6) {
+          seed = seed * 1664525u + 1013904223u;
+          input = seed / 2147483648.0 - 1.0;
+        }
+        phaseShifter.process(lfo.valueAndIncrement() * depth, input);
+
+        if (counter % samplesPerCheck == 0) {
+          maxMagnitude = std::max(maxMagnitude, phaseShifter.stateMagnitude());
+          if (phaseShifter.hasSubnormalState()) ++subnormalChecks;
+        }
+      }
+
+      expectedPhase += (long double)samplesPerSegment * rate / sampleRate;
+      expectedPhase -= std::floor(expectedPhase);
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double throughput = samplesPerSegment * combinations / elapsed;
+
+    double phaseError = double(lfo.phase() - expectedPhase);
+    if (phaseError > 0.5) phaseError -= 1.0;
+    if (phaseError < -0.5) phaseError += 1.0;
+
+    NSLog(@"pass %d - %.2f Msamples/s phaseError: %g maxMagnitude: %g subnormalChecks: %d", pass + 1,
+          throughput / 1.0e6, phaseError, maxMagnitude, subnormalChecks);
+
+    XCTAssertEqualWithAccuracy(phaseError, 0.0, 1.0e-6);
+    XCTAssertTrue(std::isfinite(maxMagnitude));
+    XCTAssertLessThan(maxMagnitude, 100.0);
+    XCTAssertEqual(subnormalChecks, 0);
+  }
+}
+
+@end
@@ -0,0 +1,59 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#import <XCTest/XCTest.h>
+#import <cmath>
+#import <vector>
+
+#import "SpectralLoss.h"
+
+@interface SpectralLossTests : XCTestCase
+@end
+
+@implementation SpectralLossTests
+
+- (std::vector<float>)tone:(double)cyclesPerFrame count:(size_t)count scale:(float)scale {
+  std::vector<float> samples(count);
+  for (size_t index = 0; index < count; ++index) {
+    samples[index] = scale * std::sin(2.0 * M_PI * cyclesPerFrame * index / 1024.0);
+  }
+  return samples;
+}
+
+- (void)testFrames {
+  auto reference = [self tone:64.0 count:4096 scale:1.0];
+  SpectralLoss<float> loss(reference.data(), reference.size());
+  XCTAssertEqual(loss.frameCount(), 7);
+  XCTAssertEqual(loss.binCount(), 513);
+
+  SpectralLoss<float> tooShort(reference.data(), 1000);
+  XCTAssertEqual(tooShort.frameCount(), 0);
+  XCTAssertEqual(tooShort(reference.data()), 0.0);
+}
+
+- (void)testOrdering {
+  auto reference = [self tone:64.0 count:4096 scale:1.0];
+  SpectralLoss<float> loss(reference.data(), reference.size());
+  XCTAssertEqual(loss(reference.data()), 0.0);
+
+  auto quieter = [self tone:64.0 count:4096 scale:0.9];
+  auto shifted = [self tone:100.0 count:4096 scale:1.0];
+  auto quieterLoss = loss(quieter.data());
+  auto shiftedLoss = loss(shifted.data());
+  XCTAssertGreaterThan(quieterLoss, 0.0);
+  XCTAssertGreaterThan(shiftedLoss, 10.0 * quieterLoss);
+}
+
+- (void)testPerformance {
+  auto reference = [self tone:64.0 count:44100 scale:1.0];
+  auto candidate = [self tone:65.0 count:44100 scale:1.0];
+  SpectralLoss<float> loss(reference.data(), reference.size());
+  auto lossPtr = &loss;
+  auto candidatePtr = &candidate;
+  [self measureBlock:^{
+    double sum = 0.0;
+    for (int iteration = 0; iteration < 100; ++iteration) sum += (*lossPtr)(candidatePtr->data());
+    XCTAssertTrue(std::isfinite(sum));
+  }];
+}
+
+@end
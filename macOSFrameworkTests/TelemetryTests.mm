@@ -0,0 +1,131 @@
+// Copyright © 2021 Brad Howes. All rights reserved.
+
+#import <XCTest/XCTest.h>
+#import <atomic>
+#import <string>
+#import <thread>
+#import <unistd.h>
+#import <vector>
+
+#import "Telemetry.hpp"
+
+@interface TelemetryTests : XCTestCase
+@end
+
+@implementation TelemetryTests {
+  std::string name_;
+}
+
+- (void)setUp {
+  name_ = "/SPTelemetryTests." + std::to_string(getpid());
+}
+
+- (void)tearDown {
+  shm_unlink(name_.c_str());
+}
+
+- (void)testHistogramBuckets {
+  XCTAssertEqual(Telemetry::Publisher::bucket(0), 0);
+  XCTAssertEqual(Telemetry::Publisher::bucket(1), 0);
+  XCTAssertEqual(Telemetry::Publisher::bucket(2), 1);
+  XCTAssertEqual(Telemetry::Publisher::bucket(3), 1);
+  XCTAssertEqual(Telemetry::Publisher::bucket(4), 2);
+  XCTAssertEqual(Telemetry::Publisher::bucket(1000), 9);
+  XCTAssertEqual(Telemetry::Publisher::bucket(uint64_t(1) << 40), Telemetry::histogramBuckets - 1);
+}
+
+- (void)testReaderRequiresSegment {
+  Telemetry::Reader reader;
+  XCTAssertFalse(reader.open(name_));
+  XCTAssertEqual(reader.sample().size(), 0);
+}
+
+- (void)testPublishAndRead {
+  Telemetry::Publisher first;
+  Telemetry::Publisher second;
+  XCTAssertTrue(first.open(name_, 2, 44100.0));
+  XCTAssertTrue(second.open(name_, 1, 48000.0));
+
+  first.recordRender(3000, 512, 0.5, 0.25, 1, 2);
+  first.recordRender(1000, 512, 0.75, 0.5, 1, 2);
+
+  Telemetry::Reader reader;
+  XCTAssertTrue(reader.open(name_));
+  auto samples = reader.sample();
+  XCTAssertEqual(samples.size(), 2);
+  XCTAssertEqual(samples[0].first, getpid());
+
+  auto const& data = samples[0].second;
+  XCTAssertEqual(data.channelCount, 2);
+  XCTAssertEqual(data.sampleRate, 44100.0);
+  XCTAssertEqual(data.renderCount, 2);
+  XCTAssertEqual(data.frameCount, 1024);
+  XCTAssertEqual(data.lastRenderNanos, 1000);
+  XCTAssertEqual(data.maxRenderNanos, 3000);
+  XCTAssertEqual(data.renderMicrosHistogram[0], 1);
+  XCTAssertEqual(data.renderMicrosHistogram[1], 1);
+  XCTAssertEqual(data.nonFiniteResetCount, 1);
+  XCTAssertEqual(data.droppedLogCount, 2);
+  XCTAssertEqual(data.inputPeak, 0.75);
+  XCTAssertEqual(data.outputPeak, 0.5);
+
+  XCTAssertEqual(samples[1].second.channelCount, 1);
+  XCTAssertEqual(samples[1].second.renderCount, 0);
+
+  second.close();
+  XCTAssertEqual(reader.sample().size(), 1);
+}
+
+- (void)testCloseWhileRecording {
+  // Stands in for the render thread publishing while another thread turns telemetry on and off. Closing must not
+  // unmap the segment out from under it.
+  Telemetry::Publisher publisher;
+  std::atomic<bool> running{true};
+  std::thread render([&publisher, &running]() {
+    while (running.load()) publisher.recordRender(1000, 512, 0.5, 0.5, 0, 0);
+  });
+  for (int index = 0; index < 200; ++index) {
+    XCTAssertTrue(publisher.open(name_, 2, 44100.0));
+    publisher.close();
+  }
+  XCTAssertTrue(publisher.open(name_, 2, 44100.0));
+  running.store(false);
+  render.join();
+
+  Telemetry::Reader reader;
+  XCTAssertTrue(reader.open(name_));
+  auto samples = reader.sample();
+  XCTAssertEqual(samples.size(), 1);
+  XCTAssertEqual(samples[0].second.frameCount, samples[0].second.renderCount * 512);
+}
+
+- (void)testConcurrentOpens {
+  // Every publisher that races to create the segment must find a valid header and a slot of its own.
+  std::vector<Telemetry::Publisher> publishers(16);
+  std::vector<std::thread> threads;
+  std::atomic<int> opened{0};
+  for (auto& publisher : publishers) {
+    threads.emplace_back([&publisher, &opened, name = name_]() {
+      if (publisher.open(name, 2, 44100.0)) opened += 1;
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  XCTAssertEqual(opened.load(), 16);
+
+  Telemetry::Reader reader;
+  XCTAssertTrue(reader.open(name_));
+  XCTAssertEqual(reader.sample().size(), 16);
+}
+
+- (void)testPublishPerformance {
+  Telemetry::Publisher publisher;
+  XCTAssertTrue(publisher.open(name_, 2, 44100.0));
+  auto publisherPtr = &publisher;
+  [self measureBlock:^{
+    for (int index = 0; index < 1'000'000; ++index) {
+      publisherPtr->recordRender(index, 512, 0.5, 0.5, 0, 0);
+    }
+  }];
+}
+
+@end